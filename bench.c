@@ -0,0 +1,300 @@
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "flock_config.h"
+#include "flock_world.h"
+#include "spatial_grid.h"
+#include "thread_pool.h"
+
+// The default window holds 500 particles in 800 x 600 x 600. Every case is
+// run at that density, so ns/particle stays comparable across counts.
+#define BASE_PARTICLES 500
+#define BASE_WIDTH 800.0f
+#define BASE_HEIGHT 600.0f
+#define BASE_DEPTH 600.0f
+#define WARMUP_FRAMES 3
+#define STEPS_PER_CASE 2000000  // particle-steps to time per case
+#define MIN_FRAMES 10
+#define MAX_FRAMES 300
+#define MAX_CASES 32
+#define MAX_NAME 64
+
+typedef struct {
+    char name[MAX_NAME];
+    int particles;
+    int neighbor_k;
+    int neighbor_mode;
+    float cell_ratio;
+    int hashed;
+    int frames;
+    double ns_per_particle;
+    double p50_ms;
+    double p99_ms;
+    double grid_kb;
+} BenchResult;
+
+typedef struct {
+    int threads;
+    unsigned seed;
+    int quick;
+    float max_regression;  // percent; 0 = report only
+    const char* baseline_path;
+    const char* out_path;
+} BenchOptions;
+
+static double get_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+static double percentile(const double* sorted, int n, double p) {
+    int idx = (int)ceil(p * n) - 1;
+    if (idx < 0) idx = 0;
+    if (idx >= n) idx = n - 1;
+    return sorted[idx];
+}
+
+static void run_case(const BenchOptions* opts, BenchResult* r) {
+    FlockConfig config;
+    flock_config_defaults(&config);
+    config.num_particles = r->particles;
+    config.neighbor_k = r->neighbor_k;
+    config.neighbor_mode = r->neighbor_mode;
+    config.grid_cell_ratio = r->cell_ratio;
+    config.hashed_grid = r->hashed;
+    config.max_frame_time_ms = 0.0f;  // never coast, every step does full work
+
+    float scale = cbrtf((float)r->particles / BASE_PARTICLES);
+    FlockWorldDesc desc = {.width = BASE_WIDTH * scale, .height = BASE_HEIGHT * scale,
+                           .depth = BASE_DEPTH * scale, .threads = opts->threads,
+                           .seed = opts->seed};
+    FlockWorld* world = flock_world_create(&desc, &config);
+
+    int frames = STEPS_PER_CASE / r->particles;
+    if (frames < MIN_FRAMES) frames = MIN_FRAMES;
+    if (frames > MAX_FRAMES) frames = MAX_FRAMES;
+    r->frames = frames;
+
+    for (int i = 0; i < WARMUP_FRAMES; i++) {
+        flock_world_step(world);
+    }
+
+    double* times = malloc(sizeof(double) * frames);
+    double total = 0.0;
+    for (int i = 0; i < frames; i++) {
+        double start = get_time_ms();
+        flock_world_step(world);
+        times[i] = get_time_ms() - start;
+        total += times[i];
+    }
+
+    qsort(times, frames, sizeof(double), compare_doubles);
+    r->ns_per_particle = total * 1e6 / ((double)frames * r->particles);
+    r->p50_ms = percentile(times, frames, 0.50);
+    r->p99_ms = percentile(times, frames, 0.99);
+    r->grid_kb = flock_world_grid_bytes(world) / 1024.0;
+
+    free(times);
+    flock_world_destroy(world);
+}
+
+static int add_case(BenchResult* cases, int n, int particles, int k, int mode,
+                    float cell_ratio, int hashed) {
+    BenchResult* r = &cases[n];
+    memset(r, 0, sizeof(*r));
+    r->particles = particles;
+    r->neighbor_k = k;
+    r->neighbor_mode = mode;
+    r->cell_ratio = cell_ratio;
+    r->hashed = hashed;
+    snprintf(r->name, sizeof(r->name), "n=%d k=%d cell=%.2f%s%s", particles, k, cell_ratio,
+             mode == FLOCK_NEIGHBORS_FIRST ? " first" : "", hashed ? " hashed" : "");
+    return n + 1;
+}
+
+// One-axis sweeps around the defaults rather than the full product, which
+// would spend most of its time on the 1M cases. First-found neighbors are
+// run against the kNN k sweep, and the hashed grid at the counts where its
+// memory starts to differ.
+static int build_cases(BenchResult* cases, int quick) {
+    static const int counts[] = {1000, 10000, 100000, 1000000};
+    static const int ks[] = {1, 4};
+    static const float ratios[] = {0.5f, 2.0f};
+    int num_counts = quick ? 3 : 4;
+    int n = 0;
+
+    for (int i = 0; i < num_counts; i++) {
+        n = add_case(cases, n, counts[i], MAX_NEIGHBORS, FLOCK_NEIGHBORS_NEAREST, 1.0f, 0);
+    }
+    for (int i = 0; i < 2; i++) {
+        n = add_case(cases, n, 10000, ks[i], FLOCK_NEIGHBORS_NEAREST, 1.0f, 0);
+    }
+    for (int i = 0; i < 2; i++) {
+        n = add_case(cases, n, 10000, MAX_NEIGHBORS, FLOCK_NEIGHBORS_NEAREST, ratios[i], 0);
+    }
+    n = add_case(cases, n, 10000, ks[1], FLOCK_NEIGHBORS_FIRST, 1.0f, 0);
+    n = add_case(cases, n, 10000, MAX_NEIGHBORS, FLOCK_NEIGHBORS_FIRST, 1.0f, 0);
+    for (int i = 1; i < num_counts; i++) {
+        n = add_case(cases, n, counts[i], MAX_NEIGHBORS, FLOCK_NEIGHBORS_NEAREST, 1.0f, 1);
+    }
+    return n;
+}
+
+// One result per line, so the baseline can be read back with sscanf. New
+// fields go last, where older baselines simply lack them.
+static int write_results(const char* path, const BenchOptions* opts,
+                         const BenchResult* results, int n) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "bench: cannot write %s\n", path);
+        return -1;
+    }
+
+    fprintf(f, "{\n  \"simd\": \"%s\",\n  \"threads\": %d,\n  \"seed\": %u,\n  \"results\": [\n",
+            particle_soa_simd_name(), opts->threads, opts->seed);
+    for (int i = 0; i < n; i++) {
+        const BenchResult* r = &results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"particles\": %d, \"neighbor_k\": %d, "
+                   "\"cell_ratio\": %.2f, \"frames\": %d, \"ns_per_particle\": %.2f, "
+                   "\"p50_ms\": %.4f, \"p99_ms\": %.4f, \"grid_kb\": %.1f, "
+                   "\"neighbor_mode\": %d}%s\n",
+                r->name, r->particles, r->neighbor_k, r->cell_ratio, r->frames,
+                r->ns_per_particle, r->p50_ms, r->p99_ms, r->grid_kb, r->neighbor_mode,
+                i + 1 < n ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return 0;
+}
+
+static int read_results(const char* path, BenchResult* results, int max) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+
+    char line[512];
+    int n = 0;
+    while (n < max && fgets(line, sizeof(line), f)) {
+        BenchResult* r = &results[n];
+        if (sscanf(line, " {\"name\": \"%63[^\"]\", \"particles\": %d, \"neighbor_k\": %d, "
+                         "\"cell_ratio\": %f, \"frames\": %d, \"ns_per_particle\": %lf, "
+                         "\"p50_ms\": %lf, \"p99_ms\": %lf}",
+                   r->name, &r->particles, &r->neighbor_k, &r->cell_ratio, &r->frames,
+                   &r->ns_per_particle, &r->p50_ms, &r->p99_ms) == 8) {
+            n++;
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+static double percent_change(double now, double before) {
+    return before > 0.0 ? 100.0 * (now - before) / before : 0.0;
+}
+
+// Returns the number of cases whose ns/particle grew past max_regression.
+static int compare_baseline(const BenchOptions* opts, const BenchResult* results, int n) {
+    BenchResult baseline[MAX_CASES];
+    int nb = read_results(opts->baseline_path, baseline, MAX_CASES);
+    if (nb < 0) {
+        printf("\nNo baseline at %s (save one with: make bench-baseline)\n", opts->baseline_path);
+        return 0;
+    }
+
+    int regressions = 0;
+    printf("\nAgainst %s:\n", opts->baseline_path);
+    printf("%-34s %12s %12s %10s %10s\n", "case", "ns/p before", "ns/p now", "ns/p", "p99");
+    for (int i = 0; i < n; i++) {
+        const BenchResult* before = NULL;
+        for (int j = 0; j < nb; j++) {
+            if (strcmp(baseline[j].name, results[i].name) == 0) before = &baseline[j];
+        }
+        if (!before) {
+            printf("%-34s %12s\n", results[i].name, "(new)");
+            continue;
+        }
+
+        double d_ns = percent_change(results[i].ns_per_particle, before->ns_per_particle);
+        double d_p99 = percent_change(results[i].p99_ms, before->p99_ms);
+        int regressed = opts->max_regression > 0.0f && d_ns > opts->max_regression;
+        regressions += regressed;
+        printf("%-34s %12.1f %12.1f %+9.1f%% %+9.1f%%%s\n", results[i].name,
+               before->ns_per_particle, results[i].ns_per_particle, d_ns, d_p99,
+               regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+static int parse_options(BenchOptions* opts, int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            opts->quick = 1;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "bench: unknown or incomplete option '%s'\n", argv[i]);
+            return -1;
+        }
+        const char* value = argv[++i];
+        if (strcmp(argv[i - 1], "--threads") == 0) {
+            opts->threads = atoi(value);
+        } else if (strcmp(argv[i - 1], "--seed") == 0) {
+            opts->seed = (unsigned)strtoul(value, NULL, 10);
+        } else if (strcmp(argv[i - 1], "--baseline") == 0) {
+            opts->baseline_path = value;
+        } else if (strcmp(argv[i - 1], "--out") == 0) {
+            opts->out_path = value;
+        } else if (strcmp(argv[i - 1], "--max-regression") == 0) {
+            opts->max_regression = strtof(value, NULL);
+        } else {
+            fprintf(stderr, "bench: unknown option '%s'\n", argv[i - 1]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opts = {.threads = 0, .seed = 1, .quick = 0, .max_regression = 0.0f,
+                         .baseline_path = NULL, .out_path = NULL};
+    if (parse_options(&opts, argc, argv) != 0) {
+        fprintf(stderr, "Usage: %s [--quick] [--threads n] [--seed n] [--out file] "
+                        "[--baseline file] [--max-regression pct]\n", argv[0]);
+        return 1;
+    }
+
+    if (opts.threads <= 0) opts.threads = thread_pool_default_size();
+
+    BenchResult results[MAX_CASES];
+    int n = build_cases(results, opts.quick);
+    printf("Flock bench: %s kernel, %d threads, seed %u\n\n",
+           particle_soa_simd_name(), opts.threads, opts.seed);
+
+    printf("%-34s %8s %12s %10s %10s %10s\n", "case", "frames", "ns/particle", "p50 ms",
+           "p99 ms", "grid KB");
+    for (int i = 0; i < n; i++) {
+        run_case(&opts, &results[i]);
+        printf("%-34s %8d %12.1f %10.3f %10.3f %10.1f\n", results[i].name, results[i].frames,
+               results[i].ns_per_particle, results[i].p50_ms, results[i].p99_ms,
+               results[i].grid_kb);
+        fflush(stdout);
+    }
+
+    if (opts.out_path && write_results(opts.out_path, &opts, results, n) != 0) {
+        return 1;
+    }
+    if (opts.baseline_path && compare_baseline(&opts, results, n) > 0) {
+        return 2;
+    }
+    return 0;
+}
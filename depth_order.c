@@ -0,0 +1,123 @@
+#include "depth_order.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Shifts allowed per particle before the insertion sort hands over. A few
+// frames of motion stay well under it; a fresh or reshuffled list doesn't.
+#define INSERTION_MOVES_PER_PARTICLE 8
+
+DepthOrder* depth_order_create(int capacity) {
+    DepthOrder* order = calloc(1, sizeof(DepthOrder));
+    if (depth_order_reserve(order, capacity > 0 ? capacity : 1) != 0) {
+        depth_order_destroy(order);
+        return NULL;
+    }
+    return order;
+}
+
+void depth_order_destroy(DepthOrder* order) {
+    if (!order) return;
+    free(order->indices);
+    free(order->keys);
+    free(order->scratch);
+    free(order);
+}
+
+static int grow_array(void** array, size_t elem_size, int capacity) {
+    void* grown = realloc(*array, elem_size * capacity);
+    if (!grown) return -1;
+    *array = grown;
+    return 0;
+}
+
+int depth_order_reserve(DepthOrder* order, int capacity) {
+    if (capacity <= order->capacity) return 0;
+    if (grow_array((void**)&order->indices, sizeof(int), capacity) != 0 ||
+        grow_array((void**)&order->keys, sizeof(uint16_t), capacity) != 0 ||
+        grow_array((void**)&order->scratch, sizeof(int), capacity) != 0) {
+        return -1;
+    }
+    order->capacity = capacity;
+    return 0;
+}
+
+void depth_order_remap(DepthOrder* order, const int* remap, int count) {
+    int* present = order->scratch;
+    memset(present, 0, sizeof(int) * count);
+
+    int kept = 0;
+    for (int i = 0; i < order->count; i++) {
+        int slot = remap ? remap[order->indices[i]] : order->indices[i];
+        if (slot < 0 || slot >= count) continue;
+        order->indices[kept++] = slot;
+        present[slot] = 1;
+    }
+    for (int slot = 0; slot < count; slot++) {
+        if (!present[slot]) order->indices[kept++] = slot;
+    }
+    order->count = kept;
+}
+
+// Stable, farthest first; returns 0 if it ran out of moves part way.
+static int insertion_sort(int* indices, int count, const float* z, long budget) {
+    for (int i = 1; i < count; i++) {
+        int slot = indices[i];
+        float key = z[slot];
+        int j = i;
+        while (j > 0 && z[indices[j - 1]] < key) {
+            indices[j] = indices[j - 1];
+            j--;
+        }
+        indices[j] = slot;
+        budget -= i - j;
+        if (budget < 0) return 0;
+    }
+    return 1;
+}
+
+// Two 8-bit LSD passes over a 16-bit key that grows as z shrinks, so the
+// ascending key order is back to front.
+static void radix_sort(DepthOrder* order, const float* z, float depth) {
+    int count = order->count;
+    float scale = depth > 0.0f ? 65535.0f / depth : 0.0f;
+    for (int i = 0; i < count; i++) {
+        int slot = order->indices[i];
+        float q = z[slot] * scale;
+        if (q < 0.0f) q = 0.0f;
+        if (q > 65535.0f) q = 65535.0f;
+        order->keys[slot] = (uint16_t)(65535 - (int)q);
+    }
+
+    int* src = order->indices;
+    int* dst = order->scratch;
+    for (int shift = 0; shift < 16; shift += 8) {
+        int offsets[256] = {0};
+        for (int i = 0; i < count; i++) {
+            offsets[(order->keys[src[i]] >> shift) & 0xFF]++;
+        }
+        int sum = 0;
+        for (int b = 0; b < 256; b++) {
+            int n = offsets[b];
+            offsets[b] = sum;
+            sum += n;
+        }
+        for (int i = 0; i < count; i++) {
+            dst[offsets[(order->keys[src[i]] >> shift) & 0xFF]++] = src[i];
+        }
+        int* tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    // An even number of passes leaves the result back in indices.
+}
+
+void depth_order_update(DepthOrder* order, const float* z, float depth) {
+    long budget = (long)order->count * INSERTION_MOVES_PER_PARTICLE;
+    if (insertion_sort(order->indices, order->count, z, budget)) return;
+    radix_sort(order, z, depth);
+    // Only particles sharing a 16-bit key can still be out of order, and
+    // they are already adjacent.
+    insertion_sort(order->indices, order->count, z, LONG_MAX);
+    order->radix_sorts++;
+}
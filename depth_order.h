@@ -0,0 +1,34 @@
+#ifndef DEPTH_ORDER_H
+#define DEPTH_ORDER_H
+
+#include <stdint.h>
+
+// Back-to-front draw order kept as a list of slot indices, so rendering
+// never moves the particle arrays. The order changes little between
+// frames, so each update is an insertion sort from the last one; when that
+// would take too many moves (after a spawn, say) a radix sort on quantized
+// z takes over.
+typedef struct {
+    int *indices;  // slots, largest z (farthest) first
+    int count;
+    int capacity;
+    uint16_t *keys;
+    int *scratch;
+    int radix_sorts;  // times the insertion sort gave up, since create
+} DepthOrder;
+
+DepthOrder *depth_order_create(int capacity);
+void depth_order_destroy(DepthOrder *order);
+// Returns -1 (order unchanged) if an allocation fails.
+int depth_order_reserve(DepthOrder *order, int capacity);
+
+// Follows the store to count slots. With remap (remap[old_slot] = new_slot,
+// -1 for removed) entries move to their new slots; without it slots past
+// count are dropped. New slots are appended in slot order either way, so
+// the list always holds each of 0..count-1 once.
+void depth_order_remap(DepthOrder *order, const int *remap, int count);
+
+// Re-sorts by z, which lies in [0, depth].
+void depth_order_update(DepthOrder *order, const float *z, float depth);
+
+#endif
@@ -0,0 +1,270 @@
+#include "flock_config.h"
+#include "spatial_grid.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_CONFIG_LINE 256
+
+typedef enum { FIELD_INT, FIELD_FLOAT } FieldType;
+
+typedef struct {
+    const char* name;
+    FieldType type;
+    size_t offset;
+    float min, max;
+} ConfigField;
+
+#define GROUP_FIELD(n, field, type, min, max) \
+    {"group" #n "_" #field, type, offsetof(FlockConfig, groups[n].field), min, max}
+#define GROUP_FIELDS(n)                                                   \
+    GROUP_FIELD(n, max_speed, FIELD_FLOAT, 0.1f, 100.0f),                 \
+    GROUP_FIELD(n, max_force, FIELD_FLOAT, 0.001f, 10.0f),                \
+    GROUP_FIELD(n, perception_radius, FIELD_FLOAT, 0.0f, 1000.0f),        \
+    GROUP_FIELD(n, separation_weight, FIELD_FLOAT, 0.0f, 10.0f),          \
+    GROUP_FIELD(n, alignment_weight, FIELD_FLOAT, 0.0f, 10.0f),           \
+    GROUP_FIELD(n, cohesion_weight, FIELD_FLOAT, 0.0f, 10.0f),            \
+    GROUP_FIELD(n, leader_weight, FIELD_FLOAT, 0.0f, 10.0f),              \
+    GROUP_FIELD(n, leader, FIELD_INT, FLOCK_LEADER_NEAREST, FLOCK_LEADER_SECOND)
+
+_Static_assert(MAX_FLOCK_GROUPS == 4, "one GROUP_FIELDS entry per group");
+
+static const ConfigField fields[] = {
+    {"num_particles", FIELD_INT, offsetof(FlockConfig, num_particles), 1, MAX_CONFIG_PARTICLES},
+    {"perception_radius", FIELD_FLOAT, offsetof(FlockConfig, perception_radius), 1.0f, 1000.0f},
+    {"grid_cell_ratio", FIELD_FLOAT, offsetof(FlockConfig, grid_cell_ratio), 0.25f, 4.0f},
+    {"hashed_grid", FIELD_INT, offsetof(FlockConfig, hashed_grid), 0, 1},
+    {"periodic_boundaries", FIELD_INT, offsetof(FlockConfig, periodic_boundaries), 0, 1},
+    {"reorder_by_cell", FIELD_INT, offsetof(FlockConfig, reorder_by_cell), 0, 1},
+    {"double_buffered", FIELD_INT, offsetof(FlockConfig, double_buffered), 0, 1},
+    {"neighbor_k", FIELD_INT, offsetof(FlockConfig, neighbor_k), 1, MAX_NEIGHBORS},
+    {"neighbor_mode", FIELD_INT, offsetof(FlockConfig, neighbor_mode), FLOCK_NEIGHBORS_NEAREST, FLOCK_NEIGHBORS_FIRST},
+    {"cache_neighbors_frames", FIELD_INT, offsetof(FlockConfig, cache_neighbors_frames), 1, 60},
+    {"neighbor_skin", FIELD_FLOAT, offsetof(FlockConfig, neighbor_skin), 0.0f, 1000.0f},
+    {"update_grid_every_n_frames", FIELD_INT, offsetof(FlockConfig, update_grid_every_n_frames), 1, 60},
+    {"sort_every_n_frames", FIELD_INT, offsetof(FlockConfig, sort_every_n_frames), 0, 600},
+    {"max_frame_time_ms", FIELD_FLOAT, offsetof(FlockConfig, max_frame_time_ms), 0.0f, 1000.0f},
+    {"lod_far_depth", FIELD_FLOAT, offsetof(FlockConfig, lod_far_depth), 0.0f, 1.0f},
+    {"lod_sparse_count", FIELD_INT, offsetof(FlockConfig, lod_sparse_count), 0, MAX_PARTICLES_PER_CELL},
+    {"lod_every_n_frames", FIELD_INT, offsetof(FlockConfig, lod_every_n_frames), 1, 8},
+    {"mean_field", FIELD_INT, offsetof(FlockConfig, mean_field), 0, 1},
+    {"mean_field_k", FIELD_INT, offsetof(FlockConfig, mean_field_k), 1, MAX_NEIGHBORS},
+    {"gpu_backend", FIELD_INT, offsetof(FlockConfig, gpu_backend), 0, 1},
+    {"flock_groups", FIELD_INT, offsetof(FlockConfig, flock_groups), 1, MAX_FLOCK_GROUPS},
+    GROUP_FIELDS(0), GROUP_FIELDS(1), GROUP_FIELDS(2), GROUP_FIELDS(3),
+};
+
+#define NUM_FIELDS (int)(sizeof(fields) / sizeof(fields[0]))
+
+void flock_config_defaults(FlockConfig* c) {
+    c->num_particles = 500;
+    c->perception_radius = 50.0f;
+    c->grid_cell_ratio = 1.0f;
+    c->hashed_grid = 0;
+    c->periodic_boundaries = 1;
+    c->reorder_by_cell = 1;
+    c->double_buffered = 1;
+    c->neighbor_k = MAX_NEIGHBORS;
+    c->neighbor_mode = FLOCK_NEIGHBORS_NEAREST;
+    c->cache_neighbors_frames = 2;
+    c->neighbor_skin = 0.0f;
+    c->update_grid_every_n_frames = 1;
+    c->sort_every_n_frames = 0;
+    c->max_frame_time_ms = 10.0f;
+    c->lod_far_depth = 1.0f;
+    c->lod_sparse_count = 0;
+    c->lod_every_n_frames = 2;
+    c->mean_field = 0;
+    c->mean_field_k = 4;
+    c->gpu_backend = 0;
+
+    // Group 0 is the original flock; the others are there to switch on.
+    c->flock_groups = 1;
+    for (int g = 0; g < MAX_FLOCK_GROUPS; g++) {
+        c->groups[g] = flock_group_default();
+    }
+    c->groups[1].max_speed = 5.0f;
+    c->groups[1].leader = FLOCK_LEADER_FIRST;
+    c->groups[2].max_speed = 3.0f;
+    c->groups[2].cohesion_weight = 1.5f;
+    c->groups[2].leader = FLOCK_LEADER_SECOND;
+    c->groups[3].perception_radius = 25.0f;
+    c->groups[3].separation_weight = 2.0f;
+    c->groups[3].leader_weight = 0.25f;
+}
+
+// Keys compare with '-' and '_' treated alike so CLI flags can use either.
+static int key_equals(const char* key, const char* name, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        char a = key[i] == '-' ? '_' : key[i];
+        if (a != name[i]) return 0;
+    }
+    return name[len] == '\0';
+}
+
+static const ConfigField* find_field(const char* key, size_t len) {
+    for (int i = 0; i < NUM_FIELDS; i++) {
+        if (key_equals(key, fields[i].name, len)) return &fields[i];
+    }
+    return NULL;
+}
+
+static float field_value(const FlockConfig* c, const ConfigField* f) {
+    const char* base = (const char*)c + f->offset;
+    return f->type == FIELD_INT ? (float)*(const int*)base : *(const float*)base;
+}
+
+static int set_field(FlockConfig* c, const ConfigField* f, const char* value) {
+    char* end;
+    float v = strtof(value, &end);
+    while (*end == ' ' || *end == '\t') end++;
+    // NaN would pass the range check and huge values overflow the int cast,
+    // so finiteness comes first and the whole-number check last.
+    if (end == value || *end != '\0' || !isfinite(v)) {
+        fprintf(stderr, "config: %s: '%s' is not a number\n", f->name, value);
+        return -1;
+    }
+    if (v < f->min || v > f->max) {
+        fprintf(stderr, "config: %s: %s is outside [%g, %g]\n", f->name, value, f->min, f->max);
+        return -1;
+    }
+    if (f->type == FIELD_INT && v != (float)(int)v) {
+        fprintf(stderr, "config: %s: '%s' is not a whole number\n", f->name, value);
+        return -1;
+    }
+
+    char* base = (char*)c + f->offset;
+    if (f->type == FIELD_INT) {
+        *(int*)base = (int)v;
+    } else {
+        *(float*)base = v;
+    }
+    return 0;
+}
+
+int flock_config_validate(const FlockConfig* c) {
+    int status = 0;
+    for (int i = 0; i < NUM_FIELDS; i++) {
+        const ConfigField* f = &fields[i];
+        float v = field_value(c, f);
+        // The negated test also catches NaN.
+        if (!(v >= f->min && v <= f->max)) {
+            fprintf(stderr, "config: %s: %g is outside [%g, %g]\n", f->name, v, f->min, f->max);
+            status = -1;
+        }
+    }
+    return status;
+}
+
+static int set_key(FlockConfig* c, const char* key, size_t len, const char* value) {
+    const ConfigField* f = find_field(key, len);
+    if (!f) {
+        fprintf(stderr, "config: unknown key '%.*s'\n", (int)len, key);
+        return -1;
+    }
+    return set_field(c, f, value);
+}
+
+int flock_config_set(FlockConfig* c, const char* key, const char* value) {
+    return set_key(c, key, strlen(key), value);
+}
+
+static char* trim(char* s) {
+    while (*s == ' ' || *s == '\t') s++;
+    char* end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) end--;
+    *end = '\0';
+    return s;
+}
+
+static int parse_line(FlockConfig* c, char* line, int line_no) {
+    char* comment = strchr(line, '#');
+    if (comment) *comment = '\0';
+    line = trim(line);
+    if (*line == '\0') return 0;
+
+    char* eq = strchr(line, '=');
+    if (!eq) {
+        fprintf(stderr, "config: line %d: expected key = value\n", line_no);
+        return -1;
+    }
+    *eq = '\0';
+    char* key = trim(line);
+    return set_key(c, key, strlen(key), trim(eq + 1));
+}
+
+int flock_config_parse_string(FlockConfig* c, const char* text) {
+    char line[MAX_CONFIG_LINE];
+    int status = 0;
+    int line_no = 0;
+
+    while (*text) {
+        size_t len = strcspn(text, "\n");
+        size_t copy = len < sizeof(line) - 1 ? len : sizeof(line) - 1;
+        memcpy(line, text, copy);
+        line[copy] = '\0';
+        text += len;
+        if (*text == '\n') text++;
+
+        if (parse_line(c, line, ++line_no) != 0) status = -1;
+    }
+    return status;
+}
+
+int flock_config_load(FlockConfig* c, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "config: cannot open %s\n", path);
+        return -1;
+    }
+
+    char line[MAX_CONFIG_LINE];
+    int status = 0;
+    int line_no = 0;
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (parse_line(c, line, ++line_no) != 0) status = -1;
+    }
+
+    fclose(f);
+    return status;
+}
+
+int flock_config_parse_args(FlockConfig* c, int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0) {
+            fprintf(stderr, "config: unexpected argument '%s'\n", arg);
+            return -1;
+        }
+        arg += 2;
+
+        const char* eq = strchr(arg, '=');
+        size_t len = eq ? (size_t)(eq - arg) : strlen(arg);
+        const char* value = eq ? eq + 1 : NULL;
+        if (!value) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "config: --%s needs a value\n", arg);
+                return -1;
+            }
+            value = argv[++i];
+        }
+
+        int status = key_equals(arg, "config", len) ? flock_config_load(c, value)
+                                                    : set_key(c, arg, len, value);
+        if (status != 0) return -1;
+    }
+    return 0;
+}
+
+void flock_config_print(const FlockConfig* c, FILE* out) {
+    for (int i = 0; i < NUM_FIELDS; i++) {
+        const char* base = (const char*)c + fields[i].offset;
+        if (fields[i].type == FIELD_INT) {
+            fprintf(out, "%s = %d\n", fields[i].name, *(const int*)base);
+        } else {
+            fprintf(out, "%s = %g\n", fields[i].name, *(const float*)base);
+        }
+    }
+}
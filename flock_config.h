@@ -0,0 +1,65 @@
+#ifndef FLOCK_CONFIG_H
+#define FLOCK_CONFIG_H
+
+#include <stdio.h>
+#include "flock_group.h"
+
+// Largest num_particles the config accepts; snapshots are held to it too.
+#define MAX_CONFIG_PARTICLES (1 << 20)
+
+enum {
+    FLOCK_NEIGHBORS_NEAREST,  // the neighbor_k closest, in (distance, slot) order
+    FLOCK_NEIGHBORS_FIRST,    // the first neighbor_k the grid walk finds in radius
+};
+
+// Tuning knobs the simulation reads every frame. Anything here can change
+// between frames; the front-ends rebuild whatever depends on it.
+typedef struct {
+    int num_particles;
+    float perception_radius;
+    float grid_cell_ratio;           // grid cell size / perception radius
+    int hashed_grid;                 // 1 = spatial hash sized by count, not volume; no wrap or mean field
+    int periodic_boundaries;         // 1 = neighbors seen across the wrap (dense grid only)
+    int reorder_by_cell;             // 1 = sort the store into grid-cell order on each grid update
+    int double_buffered;             // 1 = step into a back buffer in one pass, 0 = two passes in place
+    int neighbor_k;                  // clamped to MAX_NEIGHBORS
+    int neighbor_mode;               // FLOCK_NEIGHBORS_*
+    int cache_neighbors_frames;      // >= 1; list refresh period (native only)
+    float neighbor_skin;             // > 0 rebuilds every list once any boid moves half of it, 0 = fixed period
+    int update_grid_every_n_frames;  // >= 1
+    int sort_every_n_frames;         // 0 = never
+    float max_frame_time_ms;         // frame budget, 0 = unlimited
+    float lod_far_depth;             // z / depth past which a boid is far, 1 = none
+    int lod_sparse_count;            // boids in a cell this empty are sparse, 0 = none
+    int lod_every_n_frames;          // far or sparse boids steer this often, both twice as rarely
+    int mean_field;                  // 1 = align and cohere with cell summaries, not neighbors
+    int mean_field_k;                // nearest neighbors kept for separation in mean-field mode
+    int gpu_backend;                 // 1 = run on the GPU where the front-end can
+    int flock_groups;                // groups[0, flock_groups) fly; the GPU flies group 0 only
+    FlockGroup groups[MAX_FLOCK_GROUPS];  // keys group<N>_max_speed and so on
+} FlockConfig;
+
+void flock_config_defaults(FlockConfig *c);
+
+// Sets one field by name ("num_particles" or "num-particles"). Returns 0 on
+// success, -1 for an unknown key or a value that doesn't parse or is out of
+// range; in that case c is left unchanged and the reason goes to stderr.
+int flock_config_set(FlockConfig *c, const char *key, const char *value);
+
+// Checks every field against the same ranges flock_config_set enforces, so
+// a config built or edited in code can be rejected before it is applied.
+// Returns -1 if any is out of range (or NaN), naming each on stderr.
+int flock_config_validate(const FlockConfig *c);
+
+// "key = value" lines, '#' starts a comment. Every line is applied even if
+// an earlier one fails; returns -1 if any did.
+int flock_config_parse_string(FlockConfig *c, const char *text);
+int flock_config_load(FlockConfig *c, const char *path);
+
+// Accepts "--key value", "--key=value" and "--config path". Returns -1 on
+// the first bad argument.
+int flock_config_parse_args(FlockConfig *c, int argc, char **argv);
+
+void flock_config_print(const FlockConfig *c, FILE *out);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef FLOCK_GROUP_H
+#define FLOCK_GROUP_H
+
+// Flocks sharing one world and one grid. Each particle carries a one-byte
+// group id; everything that used to be the same for every boid lives in
+// its group instead, and the kernels read it once per particle. Particles
+// keep clear of every neighbor but align with and close on their own group
+// only, so groups move as separate flocks.
+#define MAX_FLOCK_GROUPS 4
+
+enum {
+    FLOCK_LEADER_NEAREST,  // whichever of the two leaders is closer
+    FLOCK_LEADER_FIRST,
+    FLOCK_LEADER_SECOND,
+};
+
+typedef struct {
+    float max_speed;
+    float max_force;
+    float perception_radius;  // 0 = config.perception_radius, which also caps it
+    float separation_weight;  // times the frame's oscillating separation weight
+    float alignment_weight;
+    float cohesion_weight;
+    float leader_weight;
+    int leader;               // FLOCK_LEADER_*
+} FlockGroup;
+
+// The single species every boid used to be.
+static inline FlockGroup flock_group_default(void) {
+    FlockGroup g = {4.0f, 0.1f, 0.0f, 1.0f, 1.0f, 1.0f, 0.5f, FLOCK_LEADER_NEAREST};
+    return g;
+}
+
+#endif
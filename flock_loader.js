@@ -0,0 +1,116 @@
+// Loads the threaded build (wasm SIMD + pthreads) when the browser can run
+// it, the single-threaded SIMD flock_wasm.js otherwise, and the scalar
+// flock_wasm_scalar.js (`make wasm-scalar`) where SIMD doesn't validate.
+// Threads need SharedArrayBuffer, which browsers only expose on cross-origin
+// isolated pages (served with COOP: same-origin and COEP: require-corp, as
+// `make serve` does). The candidates come from the probes alone, so a
+// build they rule out is never tried. One that fails to load (e.g. the
+// threaded one when only `make wasm` was run) or aborts before its runtime
+// is up (a compile or instantiate error) falls back to the next, ending at
+// the scalar build. None of the builds are checked in, so run at least
+// `make wasm` first. Set window.Module before this script runs.
+(function() {
+    // (func (result v128) i32.const 0 i8x16.splat i8x16.popcnt)
+    const simdProbe = new Uint8Array([
+        0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0,
+        10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11]);
+    // (memory 1 1 shared) (func i32.const 0 i32.atomic.load drop)
+    const threadsProbe = new Uint8Array([
+        0, 97, 115, 109, 1, 0, 0, 0, 1, 4, 1, 96, 0, 0, 3, 2, 1, 0, 5, 4, 1, 3, 1, 1,
+        10, 11, 1, 9, 0, 65, 0, 254, 16, 2, 0, 26, 11]);
+
+    function validates(bytes) {
+        try {
+            return WebAssembly.validate(bytes);
+        } catch (e) {
+            return false;
+        }
+    }
+
+    const isolated = self.crossOriginIsolated === true && typeof SharedArrayBuffer !== 'undefined';
+    const simd = validates(simdProbe);
+    const threads = isolated && validates(threadsProbe);
+    const builds = [];
+    if (threads) builds.push('flock_wasm_mt.js');
+    if (simd) builds.push('flock_wasm.js');
+    builds.push('flock_wasm_scalar.js');
+
+    // An aborted build leaves its state on Module, so each attempt starts
+    // from a fresh copy of what the page set.
+    const settings = Object.assign({}, window.Module || {});
+
+    // Zero-copy views of the particle state (flock_state in main_wasm.c):
+    // {generation, count, stride, x, y, z, vx, vy, vz}, each array a
+    // Float32Array over the wasm heap indexed by particle handle. The views
+    // are rebuilt only when the generation changes or memory growth has
+    // replaced the heap buffer under them (which the generation only catches
+    // at the next render), so calling this every frame allocates nothing.
+    // Contents change each frame; copy what must last.
+    let state = null;
+    let stateBuffer = null;
+    function flockState() {
+        const M = window.Module;
+        const base = M._flock_state() >> 2;
+        const header = M.HEAPU32;
+        const generation = header[base];
+        if (state && state.generation === generation && stateBuffer === M.HEAPF32.buffer) {
+            return state;
+        }
+
+        const count = header[base + 1];
+        const stride = header[base + 2];
+        const length = count > 0 ? (count - 1) * stride + 1 : 0;
+        const view = (field) => {
+            const ptr = header[base + 3 + field];
+            return ptr ? new Float32Array(M.HEAPF32.buffer, ptr, length) : null;
+        };
+        state = {generation, count, stride, x: view(0), y: view(1), z: view(2),
+                 vx: view(3), vy: view(4), vz: view(5)};
+        stateBuffer = M.HEAPF32.buffer;
+        return state;
+    }
+
+    function load(index) {
+        const src = builds[index];
+        let running = false;
+        let failed = false;
+        const script = document.createElement('script');
+        function fallBack(reason) {
+            if (failed || running) return;
+            failed = true;
+            script.remove();
+            if (index + 1 < builds.length) {
+                console.warn('Flock build: ' + src + ' ' + reason + ', trying ' +
+                             builds[index + 1]);
+                load(index + 1);
+            } else {
+                console.error('Flock build: ' + src + ' ' + reason + '; build it with make');
+            }
+        }
+
+        state = null;
+        window.Module = Object.assign({}, settings, {
+            flockState,
+            // Workers load the same script, which may not be the page's own.
+            mainScriptUrlOrBlob: src,
+            onRuntimeInitialized: function() {
+                running = true;
+                if (settings.onRuntimeInitialized) settings.onRuntimeInitialized();
+            },
+            // Called for compile and instantiate errors, which onerror misses.
+            onAbort: function(what) {
+                if (settings.onAbort) settings.onAbort(what);
+                fallBack('aborted (' + what + ')');
+            },
+        });
+        console.log('Flock build: ' + src + ' (simd ' + simd + ', threads ' + threads +
+                    (isolated ? '' : ', page not cross-origin isolated') + ')');
+
+        script.src = src;
+        script.onerror = function() {
+            fallBack('failed to load');
+        };
+        document.body.appendChild(script);
+    }
+    load(0);
+})();
@@ -0,0 +1,1082 @@
+#define _POSIX_C_SOURCE 199309L
+#include "flock_world.h"
+#include "depth_order.h"
+#include "rng.h"
+#include "snapshot.h"
+#include "spatial_grid.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define ORBIT_RADIUS 250.0f
+#define LEADER_SPEED 0.015f
+#define LEADER_INTERPOLATION 0.05f
+#define SEPARATION_OSCILLATION_SPEED 0.01f
+#define STAGGER_CACHE_UPDATES 1
+#define SIM_CHUNK_SIZE 256
+#define SPAWN_CHUNK_SIZE 4096
+#define ENABLE_PROFILING 1
+#define MEAN_FIELD_SEPARATION_REACH 0.25f  // of perception_radius, for mean-field lists
+#define VERLET_CANDIDATES (2 * MAX_NEIGHBORS)  // skin lists keep spares past the kernel's k
+
+typedef struct {
+    int neighbors[MAX_NEIGHBORS];
+    int count;
+    int frame_cached;
+    float held_accel[3];  // last steering, re-applied while the particle coasts a LOD tier
+} NeighborCache;
+
+// A skin list, kept beside the particle's NeighborCache entry only while
+// neighbor_skin is above 0; the entry's own list is unused then.
+typedef struct {
+    int neighbors[VERLET_CANDIDATES];
+    float offsets[VERLET_CANDIDATES][3];  // neighbor minus particle when the list was built
+    float origin[3];  // particle position when the list was built
+    float reach;      // every particle this close then is a candidate
+    int count;
+} NeighborSkin;
+
+struct FlockWorld {
+    FlockConfig config;
+    float width, height, depth;
+
+    ParticleSoA* particles;
+    ParticleSoA* particles_back;  // NULL unless config.double_buffered
+    SpatialGrid* spatial_grid;
+    NeighborCache* neighbor_cache;
+    NeighborCache* neighbor_cache_scratch;
+    NeighborSkin* neighbor_skin;  // NULL unless config.neighbor_skin > 0
+    NeighborSkin* neighbor_skin_scratch;
+    DepthOrder* depth_order;
+    ThreadPool* thread_pool;
+    Rng rng;
+
+    Vector3D leader1, leader2;
+    Vector3D target_leader1, target_leader2;
+    Vector3D target;
+    bool follow_target;
+    float leader_angle;
+    float separation_time;
+    int frame_counter;
+    int current_frame;
+    int budget_handle;  // particle the next step starts from; reorders move its slot
+    bool grid_stale;    // grid is new or holds old slots; the next step rebuilds it
+    bool skin_stale;    // count, config or bounds changed; the next step rebuilds skin lists
+
+    FlockWorldStats stats;
+};
+
+static double get_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Neighbor offsets take the minimum image only when the grid wraps too.
+static void set_periodic(FlockWorld* world) {
+    int periodic = world->spatial_grid->periodic;
+    particle_soa_set_periodic(world->particles, periodic, world->width, world->height,
+                              world->depth);
+    if (world->particles_back) {
+        particle_soa_set_periodic(world->particles_back, periodic, world->width,
+                                  world->height, world->depth);
+    }
+}
+
+// The grid is sized by particle capacity, perception radius and the world
+// bounds, so it is rebuilt whenever any of them changes. A new grid is empty
+// until the next step fills it.
+static void create_grid(FlockWorld* world) {
+    if (world->spatial_grid) {
+        spatial_grid_destroy(world->spatial_grid);
+    }
+    float cell_size = world->config.perception_radius * world->config.grid_cell_ratio;
+    if (world->config.hashed_grid) {
+        world->spatial_grid =
+            spatial_grid_create_hashed(cell_size, world->particles->capacity, 0);
+    } else {
+        world->spatial_grid = spatial_grid_create(world->width, world->height, world->depth,
+                                                  cell_size, world->particles->capacity);
+    }
+
+    // Mean field reads per-group cell summaries, which only a dense grid has.
+    int summary_groups = world->config.mean_field ? world->particles->group_count : 0;
+    if (spatial_grid_set_summaries(world->spatial_grid, summary_groups) != 0) {
+        fprintf(stderr, world->config.hashed_grid
+                            ? "mean_field needs the dense grid, steering from neighbors\n"
+                            : "Cannot allocate cell summaries, steering from neighbors\n");
+        world->config.mean_field = 0;
+    }
+
+    world->grid_stale = true;
+    world->skin_stale = true;
+
+    // Hashed grids can't wrap, so steering measures plain distances there.
+    spatial_grid_set_periodic(world->spatial_grid, world->config.periodic_boundaries);
+    set_periodic(world);
+}
+
+// Cached lists hold slot indices, so after the store is permuted each entry
+// follows its particle to its new slot (order[]) and its contents are
+// remapped; neighbors that were removed (remap -1) are dropped. The depth
+// order holds slots too and is remapped the same way.
+static void remap_slot_lists(FlockWorld* world) {
+    const ParticleSoA* particles = world->particles;
+    for (int k = 0; k < particles->count; k++) {
+        NeighborCache* dst = &world->neighbor_cache_scratch[k];
+        *dst = world->neighbor_cache[particles->order[k]];
+        int kept = 0;
+        for (int j = 0; j < dst->count; j++) {
+            int slot = particles->remap[dst->neighbors[j]];
+            if (slot >= 0) dst->neighbors[kept++] = slot;
+        }
+        dst->count = kept;
+    }
+
+    NeighborCache* tmp = world->neighbor_cache;
+    world->neighbor_cache = world->neighbor_cache_scratch;
+    world->neighbor_cache_scratch = tmp;
+
+    if (world->neighbor_skin) {
+        for (int k = 0; k < particles->count; k++) {
+            NeighborSkin* dst = &world->neighbor_skin_scratch[k];
+            *dst = world->neighbor_skin[particles->order[k]];
+            int kept = 0;
+            for (int j = 0; j < dst->count; j++) {
+                int slot = particles->remap[dst->neighbors[j]];
+                if (slot < 0) continue;
+                dst->offsets[kept][0] = dst->offsets[j][0];
+                dst->offsets[kept][1] = dst->offsets[j][1];
+                dst->offsets[kept][2] = dst->offsets[j][2];
+                dst->neighbors[kept++] = slot;
+            }
+            dst->count = kept;
+        }
+
+        NeighborSkin* skin_tmp = world->neighbor_skin;
+        world->neighbor_skin = world->neighbor_skin_scratch;
+        world->neighbor_skin_scratch = skin_tmp;
+    }
+
+    depth_order_remap(world->depth_order, particles->remap, particles->count);
+}
+
+// An empty list due for a rebuild, with no steering to hold.
+static void reset_cache_entry(NeighborCache* cache) {
+    cache->count = 0;
+    cache->frame_cached = -1;
+    cache->held_accel[0] = cache->held_accel[1] = cache->held_accel[2] = 0.0f;
+}
+
+typedef struct {
+    FlockWorld* world;
+    int first;
+    uint64_t seed;
+} SpawnTask;
+
+static void spawn_chunk(void* ctx, int begin, int end, int thread_idx) {
+    (void)thread_idx;
+    const SpawnTask* task = (const SpawnTask*)ctx;
+    FlockWorld* world = task->world;
+    int first = task->first + begin;
+    int last = task->first + end;
+
+    particle_soa_fill_random(world->particles, first, last, task->seed,
+                             world->width, world->height, world->depth);
+    for (int i = first; i < last; i++) {
+        reset_cache_entry(&world->neighbor_cache[i]);
+    }
+}
+
+// Grows every per-particle array, doubling, until count fit. Returns -1 if
+// an allocation fails.
+static int reserve_particles(FlockWorld* world, int count) {
+    if (count <= world->particles->capacity) return 0;
+    int capacity = world->particles->capacity > 0 ? world->particles->capacity : 1;
+    while (capacity < count) capacity *= 2;
+    NeighborCache* cache = realloc(world->neighbor_cache, sizeof(NeighborCache) * capacity);
+    if (cache) world->neighbor_cache = cache;
+    NeighborCache* scratch =
+        realloc(world->neighbor_cache_scratch, sizeof(NeighborCache) * capacity);
+    if (scratch) world->neighbor_cache_scratch = scratch;
+    if (world->neighbor_skin) {
+        NeighborSkin* skin = realloc(world->neighbor_skin, sizeof(NeighborSkin) * capacity);
+        if (skin) world->neighbor_skin = skin;
+        NeighborSkin* skin_scratch =
+            realloc(world->neighbor_skin_scratch, sizeof(NeighborSkin) * capacity);
+        if (skin_scratch) world->neighbor_skin_scratch = skin_scratch;
+        if (!skin || !skin_scratch) cache = NULL;
+    }
+    if (!cache || !scratch || particle_soa_reserve(world->particles, capacity) != 0 ||
+        depth_order_reserve(world->depth_order, capacity) != 0 ||
+        (world->particles_back &&
+         particle_soa_reserve(world->particles_back, capacity) != 0)) {
+        fprintf(stderr, "Cannot grow to %d particles\n", count);
+        return -1;
+    }
+    return 0;
+}
+
+// Grows or shrinks the flock in place. New particles spawn at random, in
+// parallel, and pick up their neighbors on the next step; shrinking drops
+// the newest.
+static void set_particle_count(FlockWorld* world, int count) {
+    ParticleSoA* particles = world->particles;
+    if (reserve_particles(world, count) != 0) return;
+
+    if (count < particles->count) {
+        particle_soa_truncate(particles, count);
+        remap_slot_lists(world);
+    }
+    if (count > particles->count) {
+        // Each batch gets a fresh seed from the world stream, so the flock
+        // depends on the world seed and never on the thread count.
+        SpawnTask task = {world, particle_soa_claim(particles, count - particles->count),
+                          rng_next(&world->rng)};
+        thread_pool_parallel_for(world->thread_pool, particles->count - task.first,
+                                 SPAWN_CHUNK_SIZE, spawn_chunk, &task);
+        depth_order_remap(world->depth_order, NULL, particles->count);
+    }
+    if (world->particles_back) world->particles_back->count = particles->count;
+    // The grid still indexes the old slots.
+    world->grid_stale = true;
+    world->skin_stale = true;
+}
+
+static void free_skin_lists(FlockWorld* world) {
+    free(world->neighbor_skin);
+    free(world->neighbor_skin_scratch);
+    world->neighbor_skin = NULL;
+    world->neighbor_skin_scratch = NULL;
+}
+
+// Skin lists take several times the memory of period lists, so they are
+// allocated only while neighbor_skin is set. Switching between the two
+// leaves the other kind out of date, so every list is rebuilt on the next
+// step.
+static void set_skin_lists(FlockWorld* world) {
+    bool on = world->config.neighbor_skin > 0.0f;
+    if (on == (world->neighbor_skin != NULL)) return;
+    free_skin_lists(world);
+    if (on) {
+        int capacity = world->particles->capacity > 0 ? world->particles->capacity : 1;
+        world->neighbor_skin = malloc(sizeof(NeighborSkin) * capacity);
+        world->neighbor_skin_scratch = malloc(sizeof(NeighborSkin) * capacity);
+        if (!world->neighbor_skin || !world->neighbor_skin_scratch) {
+            fprintf(stderr, "Cannot allocate skin lists, using the fixed period\n");
+            free_skin_lists(world);
+            world->config.neighbor_skin = 0.0f;
+            return;
+        }
+    }
+    for (int i = 0; i < world->particles->count; i++) {
+        world->neighbor_cache[i].frame_cached = -1;
+    }
+}
+
+static void set_groups(FlockWorld* world) {
+    particle_soa_set_groups(world->particles, world->config.groups, world->config.flock_groups);
+    if (world->particles_back) {
+        particle_soa_set_groups(world->particles_back, world->config.groups,
+                                world->config.flock_groups);
+    }
+}
+
+// The back buffer is a second copy of every particle array, so it exists
+// only while double_buffered is set. Its frame state is written in full by
+// each step before the swap; only the count, groups and period are carried.
+static void set_back_buffer(FlockWorld* world) {
+    bool on = world->config.double_buffered != 0;
+    if (on == (world->particles_back != NULL)) return;
+    if (!on) {
+        particle_soa_destroy(world->particles_back);
+        world->particles_back = NULL;
+        return;
+    }
+    ParticleSoA* back = particle_soa_create(world->particles->capacity);
+    back->count = world->particles->count;
+    particle_soa_set_groups(back, world->config.groups, world->config.flock_groups);
+    particle_soa_set_periodic(back, world->particles->periodic, world->width, world->height,
+                              world->depth);
+    world->particles_back = back;
+}
+
+FlockWorld* flock_world_create(const FlockWorldDesc* desc, const FlockConfig* config) {
+    FlockWorld* world = calloc(1, sizeof(FlockWorld));
+
+    world->config = *config;
+    world->width = desc->width;
+    world->height = desc->height;
+    world->depth = desc->depth;
+    rng_seed(&world->rng, desc->seed);
+    world->thread_pool = thread_pool_create(desc->threads);
+
+    int capacity = config->num_particles;
+    world->particles = particle_soa_create(capacity);
+    world->neighbor_cache = calloc(capacity, sizeof(NeighborCache));
+    world->neighbor_cache_scratch = calloc(capacity, sizeof(NeighborCache));
+    world->depth_order = depth_order_create(capacity);
+    set_back_buffer(world);
+    set_groups(world);
+    set_particle_count(world, capacity);
+    set_skin_lists(world);
+    create_grid(world);
+
+    Vector3D center = vec3_create(world->width / 2.0f, world->height / 2.0f, world->depth / 2.0f);
+    world->leader1 = center;
+    world->leader2 = center;
+    world->target_leader1 = center;
+    world->target_leader2 = center;
+    world->target = center;
+
+    return world;
+}
+
+void flock_world_destroy(FlockWorld* world) {
+    thread_pool_destroy(world->thread_pool);
+    spatial_grid_destroy(world->spatial_grid);
+    free(world->neighbor_cache);
+    free(world->neighbor_cache_scratch);
+    free_skin_lists(world);
+    depth_order_destroy(world->depth_order);
+    particle_soa_destroy(world->particles);
+    if (world->particles_back) particle_soa_destroy(world->particles_back);
+    free(world);
+}
+
+int flock_world_set_config(FlockWorld* world, const FlockConfig* config) {
+    if (flock_config_validate(config) != 0) return -1;
+    bool rebuild_grid = config->perception_radius != world->config.perception_radius ||
+                        config->grid_cell_ratio != world->config.grid_cell_ratio ||
+                        config->hashed_grid != world->config.hashed_grid ||
+                        config->periodic_boundaries != world->config.periodic_boundaries ||
+                        config->mean_field != world->config.mean_field ||
+                        (config->mean_field &&
+                         config->flock_groups != world->config.flock_groups) ||
+                        config->num_particles > world->particles->capacity;
+    world->config = *config;
+    set_back_buffer(world);
+    set_groups(world);
+
+    if (world->config.num_particles != world->particles->count) {
+        set_particle_count(world, world->config.num_particles);
+        world->config.num_particles = world->particles->count;
+    }
+    set_skin_lists(world);
+    // Skin lists depend on the radius, the skin and the neighbor mode.
+    world->skin_stale = true;
+    if (rebuild_grid) {
+        create_grid(world);
+    }
+    return 0;
+}
+
+const FlockConfig* flock_world_config(const FlockWorld* world) {
+    return &world->config;
+}
+
+void flock_world_resize(FlockWorld* world, float width, float height, float depth) {
+    world->width = width;
+    world->height = height;
+    world->depth = depth;
+    create_grid(world);
+}
+
+void flock_world_set_target(FlockWorld* world, const Vector3D* target) {
+    world->follow_target = target != NULL;
+    if (target) world->target = *target;
+}
+
+const ParticleSoA* flock_world_particles(const FlockWorld* world) {
+    return world->particles;
+}
+
+int flock_world_get_positions(const FlockWorld* world, float* out, int max) {
+    const ParticleSoA* particles = world->particles;
+    int count = particles->count < max ? particles->count : max;
+    for (int i = 0; i < count; i++) {
+        out[i * 3 + 0] = particles->x[i];
+        out[i * 3 + 1] = particles->y[i];
+        out[i * 3 + 2] = particles->z[i];
+    }
+    return count;
+}
+
+const int* flock_world_depth_order(const FlockWorld* world) {
+    return world->config.sort_every_n_frames > 0 ? world->depth_order->indices : NULL;
+}
+
+const FlockWorldStats* flock_world_stats(const FlockWorld* world) {
+    return &world->stats;
+}
+
+void flock_world_reset_stats(FlockWorld* world) {
+    FlockWorldStats empty = {0};
+    world->stats = empty;
+}
+
+int flock_world_thread_count(const FlockWorld* world) {
+    return thread_pool_size(world->thread_pool);
+}
+
+size_t flock_world_grid_bytes(const FlockWorld* world) {
+    return spatial_grid_bytes(world->spatial_grid);
+}
+
+int flock_world_save_snapshot(const FlockWorld* world, const char* path, unsigned flags) {
+    if (world->particles->group_count > 1) flags |= SNAPSHOT_GROUPS;
+    SnapshotHeader header = {
+        .flags = flags,
+        .width = world->width, .height = world->height, .depth = world->depth,
+        .leader1 = {world->leader1.x, world->leader1.y, world->leader1.z},
+        .leader2 = {world->leader2.x, world->leader2.y, world->leader2.z},
+        .leader_angle = world->leader_angle,
+        .separation_time = world->separation_time,
+        .rng_state = world->rng.state,
+        .frame = (uint32_t)world->current_frame,
+    };
+    size_t size = snapshot_size(world->particles->count, flags);
+    void* data = malloc(size);
+    if (!data) return -1;
+    snapshot_encode(&header, world->particles, data);
+
+    FILE* f = fopen(path, "wb");
+    int status = f && fwrite(data, 1, size, f) == size ? 0 : -1;
+    if (f && fclose(f) != 0) status = -1;
+    free(data);
+    return status;
+}
+
+// The world wraps, so a position outside it is brought back in the same way.
+static float wrap_into(float v, float bound) {
+    if (v >= 0.0f && v <= bound) return v;
+    v = fmodf(v, bound);
+    return v < 0.0f ? v + bound : v;
+}
+
+int flock_world_load_snapshot(FlockWorld* world, const void* data, size_t size) {
+    const SnapshotHeader* header = snapshot_check(data, size);
+    if (!header) return -1;
+    int count = (int)header->count;
+    bool grew = count > world->particles->capacity;
+    if (reserve_particles(world, count) != 0) return -1;
+
+    ParticleSoA* particles = world->particles;
+    snapshot_decode(data, particles);
+    if (world->particles_back) world->particles_back->count = count;
+    // A snapshot taken with other bounds is stretched to fit these.
+    float sx = header->width > 0.0f ? world->width / header->width : 1.0f;
+    float sy = header->height > 0.0f ? world->height / header->height : 1.0f;
+    float sz = header->depth > 0.0f ? world->depth / header->depth : 1.0f;
+    for (int i = 0; i < count; i++) {
+        particles->handle_of_slot[i] = i;
+        particles->slot_of_handle[i] = i;
+        reset_cache_entry(&world->neighbor_cache[i]);
+        // Float snapshots can hold anything finite; the grid expects bounds.
+        particles->x[i] = wrap_into(particles->x[i] * sx, world->width);
+        particles->y[i] = wrap_into(particles->y[i] * sy, world->height);
+        particles->z[i] = wrap_into(particles->z[i] * sz, world->depth);
+    }
+    depth_order_remap(world->depth_order, NULL, 0);
+    depth_order_remap(world->depth_order, NULL, count);
+
+    world->leader1 = vec3_create(header->leader1[0] * sx, header->leader1[1] * sy,
+                                 header->leader1[2] * sz);
+    world->leader2 = vec3_create(header->leader2[0] * sx, header->leader2[1] * sy,
+                                 header->leader2[2] * sz);
+    world->leader_angle = header->leader_angle;
+    world->separation_time = header->separation_time;
+    // Zero is xorshift's fixed point, so a zeroed state is reseeded.
+    world->rng.state = header->rng_state;
+    if (world->rng.state == 0) rng_seed(&world->rng, header->frame);
+    world->current_frame = (int)header->frame;
+    world->frame_counter = 0;
+    world->budget_handle = 0;
+    world->config.num_particles = count;
+    world->skin_stale = true;
+
+    // The grid is built here once, so even a step that skips its own grid
+    // update finds the loaded flock.
+    if (grew) create_grid(world);
+    spatial_grid_update_soa_parallel(world->spatial_grid, particles, world->thread_pool);
+    world->grid_stale = false;
+    return 0;
+}
+
+int flock_world_load_snapshot_file(FlockWorld* world, const char* path) {
+    size_t size = 0;
+    const void* data = snapshot_map(path, &size);
+    if (!data) return -1;
+    int status = flock_world_load_snapshot(world, data, size);
+    snapshot_unmap(data, size);
+    return status;
+}
+
+// A step visits particles in a rotated order starting at budget_handle's
+// slot, so task ranges are positions in that order, not slots.
+typedef struct {
+    FlockWorld* world;
+    float separation_weight;
+    double frame_start;
+    int cursor;
+    int count;
+    bool lod;  // any LOD tier criterion is on
+    bool mean_field;
+    atomic_int first_deferred;  // earliest position left to coast, count if none
+    atomic_int deferred;
+    atomic_int rebuilds;
+    atomic_int lod_skipped;
+    atomic_int lod_tiers[FLOCK_LOD_TIERS];
+} FlockTask;
+
+static inline float offset_axis(const ParticleSoA* particles, float d, float period) {
+    if (!particles->periodic) return d;
+    if (d > 0.5f * period) return d - period;
+    if (d < -0.5f * period) return d + period;
+    return d;
+}
+
+static void neighbor_offset(const ParticleSoA* particles, int i, int j, float out[3]) {
+    out[0] = offset_axis(particles, particles->x[j] - particles->x[i], particles->period_x);
+    out[1] = offset_axis(particles, particles->y[j] - particles->y[i], particles->period_y);
+    out[2] = offset_axis(particles, particles->z[j] - particles->z[i], particles->period_z);
+}
+
+// How far particle i has moved since the lists were last built, squared,
+// taking the minimum image across the wrap.
+static float skin_displacement_sq(const ParticleSoA* particles, int i, const NeighborSkin* list) {
+    float dx = offset_axis(particles, particles->x[i] - list->origin[0], particles->period_x);
+    float dy = offset_axis(particles, particles->y[i] - list->origin[1], particles->period_y);
+    float dz = offset_axis(particles, particles->z[i] - list->origin[2], particles->period_z);
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// Picks what a fresh query at radius would return from the candidates: the
+// k nearest in (distance, slot) order, or the first k inside radius when
+// nearest is false. Returns how many; *farthest is the last one's distance,
+// or radius if there are fewer than k.
+static int select_neighbors(const ParticleSoA* particles, int i, const NeighborSkin* cache,
+                            float radius, int k, bool nearest, int* out,
+                            float* farthest) {
+    float dist_sq[MAX_NEIGHBORS];
+    float radius_sq = radius * radius;
+    int count = 0;
+    for (int n = 0; n < cache->count; n++) {
+        float d[3];
+        neighbor_offset(particles, i, cache->neighbors[n], d);
+        float dsq = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+        if (dsq > radius_sq) continue;
+        int slot = cache->neighbors[n];
+        if (!nearest) {
+            dist_sq[count] = dsq;
+            out[count++] = slot;
+            if (count == k) break;
+            continue;
+        }
+        if (count == k && (dsq > dist_sq[k - 1] ||
+                           (dsq == dist_sq[k - 1] && slot > out[k - 1]))) {
+            continue;
+        }
+        int at = count < k ? count++ : k - 1;
+        while (at > 0 && (dsq < dist_sq[at - 1] ||
+                          (dsq == dist_sq[at - 1] && slot < out[at - 1]))) {
+            dist_sq[at] = dist_sq[at - 1];
+            out[at] = out[at - 1];
+            at--;
+        }
+        dist_sq[at] = dsq;
+        out[at] = slot;
+    }
+    *farthest = count == k ? sqrtf(dist_sq[k - 1]) : radius;
+    return count;
+}
+
+// Mean-field lists only feed separation, so they stay short and near.
+static float neighbor_radius(const FlockWorld* world) {
+    float scale = world->config.mean_field ? MEAN_FIELD_SEPARATION_REACH : 1.0f;
+    return world->config.perception_radius * scale;
+}
+
+// Rebuilds particle i's skin list: candidates out to the radius plus the
+// skin, and where the particle is now.
+static void build_skin_list(FlockWorld* world, int i) {
+    NeighborSkin* list = &world->neighbor_skin[i];
+    const ParticleSoA* particles = world->particles;
+    float reach = neighbor_radius(world) + world->config.neighbor_skin;
+    Vector3D position = vec3_create(particles->x[i], particles->y[i], particles->z[i]);
+    if (world->config.neighbor_mode == FLOCK_NEIGHBORS_NEAREST) {
+        list->count = spatial_grid_query_nearest_soa_into(world->spatial_grid, particles,
+                                                          &position, reach, i,
+                                                          list->neighbors, VERLET_CANDIDATES);
+    } else {
+        list->count = spatial_grid_query_neighbors_soa_into(world->spatial_grid, particles,
+                                                            &position, reach,
+                                                            list->neighbors, VERLET_CANDIDATES);
+    }
+    for (int n = 0; n < list->count; n++) {
+        neighbor_offset(particles, i, list->neighbors[n], list->offsets[n]);
+    }
+    list->origin[0] = particles->x[i];
+    list->origin[1] = particles->y[i];
+    list->origin[2] = particles->z[i];
+    // A full kNN list is complete only out to its farthest candidate.
+    list->reach = reach;
+    if (world->config.neighbor_mode == FLOCK_NEIGHBORS_NEAREST &&
+        list->count == VERLET_CANDIDATES) {
+        const float* last = list->offsets[VERLET_CANDIDATES - 1];
+        list->reach = sqrtf(last[0] * last[0] + last[1] * last[1] + last[2] * last[2]);
+    }
+}
+
+static void skin_chunk(void* ctx, int begin, int end, int thread_idx) {
+    (void)thread_idx;
+    FlockWorld* world = (FlockWorld*)ctx;
+    for (int i = begin; i < end; i++) {
+        build_skin_list(world, i);
+    }
+}
+
+typedef struct {
+    const FlockWorld* world;
+    atomic_int moved;
+} DriftTask;
+
+static void drift_chunk(void* ctx, int begin, int end, int thread_idx) {
+    (void)thread_idx;
+    DriftTask* task = (DriftTask*)ctx;
+    const FlockWorld* world = task->world;
+    float skin = world->config.neighbor_skin;
+    float limit_sq = 0.25f * skin * skin;
+    if (atomic_load(&task->moved)) return;
+    for (int i = begin; i < end; i++) {
+        if (skin_displacement_sq(world->particles, i, &world->neighbor_skin[i]) > limit_sq) {
+            atomic_store(&task->moved, 1);
+            return;
+        }
+    }
+}
+
+// The classic Verlet criterion: every list is rebuilt together once any
+// particle has moved more than half the skin since the last build, so no
+// pair has closed by more than the skin and nothing outside a list can have
+// come inside the radius. A new count, config or bounds always rebuilds.
+// Returns how many lists were rebuilt.
+static int update_skin_lists(FlockWorld* world) {
+    int count = world->particles->count;
+    if (!world->skin_stale) {
+        DriftTask task = {.world = world};
+        atomic_init(&task.moved, 0);
+        thread_pool_parallel_for(world->thread_pool, count, SIM_CHUNK_SIZE, drift_chunk, &task);
+        if (!atomic_load(&task.moved)) return 0;
+    }
+    trace_begin("skin lists");
+    thread_pool_parallel_for(world->thread_pool, count, SIM_CHUNK_SIZE, skin_chunk, world);
+    trace_end();
+    world->skin_stale = false;
+    return count;
+}
+
+// Fills neighbors with what steering uses this step; returns 1 if that took
+// a grid query. With a skin the k are picked from the particle's list, which
+// update_skin_lists keeps complete out to the radius; only a capped list
+// that no longer reaches a skin past its k-th pick falls back to a fresh
+// query. Without one, lists are rebuilt every cache_neighbors_frames,
+// staggered by slot, or by age for particles steering only every few steps
+// (steps > 1), since they could keep missing their stagger slot.
+static int refresh_neighbor_cache(FlockWorld* world, int i, int steps, int* neighbors,
+                                  int* count) {
+    NeighborCache* cache = &world->neighbor_cache[i];
+    const ParticleSoA* particles = world->particles;
+    float radius = neighbor_radius(world);
+    int k = world->config.mean_field ? world->config.mean_field_k : world->config.neighbor_k;
+    bool nearest = world->config.neighbor_mode == FLOCK_NEIGHBORS_NEAREST;
+
+    if (world->neighbor_skin) {
+        const NeighborSkin* list = &world->neighbor_skin[i];
+        float farthest;
+        *count = select_neighbors(particles, i, list, radius, k, nearest, neighbors,
+                                  &farthest);
+        if (farthest + world->config.neighbor_skin <= list->reach) return 0;
+    } else if (cache->frame_cached >= 0) {
+        int period = world->config.cache_neighbors_frames;
+        int age = world->current_frame - cache->frame_cached;
+#if STAGGER_CACHE_UPDATES
+        int stagger_group = i % period;
+        bool should_update = steps > 1 ? age >= period
+                                       : (world->current_frame % period) == stagger_group;
+#else
+        (void)steps;
+        bool should_update = age >= period;
+#endif
+        if (!should_update) {
+            // neighbor_k may have dropped since the list was built.
+            *count = cache->count < k ? cache->count : k;
+            memcpy(neighbors, cache->neighbors, sizeof(int) * *count);
+            return 0;
+        }
+    }
+
+    Vector3D position = vec3_create(particles->x[i], particles->y[i], particles->z[i]);
+    if (nearest) {
+        cache->count = spatial_grid_query_nearest_soa_into(
+            world->spatial_grid, particles, &position, radius, i, cache->neighbors, k);
+    } else {
+        cache->count = spatial_grid_query_neighbors_soa_into(
+            world->spatial_grid, particles, &position, radius, cache->neighbors, k);
+    }
+    cache->frame_cached = world->current_frame;
+    memcpy(neighbors, cache->neighbors, sizeof(int) * cache->count);
+    *count = cache->count;
+    return 1;
+}
+
+// The clock is read once per chunk, from the second on, so every step
+// updates at least the first chunk in its order and the cursor always moves.
+static bool chunk_over_budget(const FlockTask* task, int begin) {
+    float budget = task->world->config.max_frame_time_ms;
+    return budget > 0.0f && begin >= SIM_CHUNK_SIZE &&
+           get_time_ms() - task->frame_start > budget;
+}
+
+// Over budget, the rest of this range coasts on its current velocity. The
+// earliest coasting position becomes the next step's starting point, so
+// skipped particles go first next time instead of the tail always losing.
+static void defer_range(FlockTask* task, int begin, int end) {
+    atomic_fetch_add(&task->deferred, end - begin);
+    int first = atomic_load(&task->first_deferred);
+    while (begin < first &&
+           !atomic_compare_exchange_weak(&task->first_deferred, &first, begin)) {
+    }
+}
+
+static int slot_at(const FlockTask* task, int position) {
+    int slot = task->cursor + position;
+    return slot < task->count ? slot : slot - task->count;
+}
+
+// Steps of steering particle i takes this step: 1 in tier 0; in the lower
+// tiers its tier's interval once every interval steps (staggered by handle,
+// which survives reordering) and 0 in between, when it coasts on the held
+// steering. The cell population comes from the last grid update.
+static int lod_steps(const FlockTask* task, int i, int* tiers) {
+    if (!task->lod) {
+        tiers[0]++;
+        return 1;
+    }
+    const FlockWorld* world = task->world;
+    const FlockConfig* config = &world->config;
+    const ParticleSoA* particles = world->particles;
+    int tier = particles->z[i] > config->lod_far_depth * world->depth;
+    if (config->lod_sparse_count > 0 &&
+        spatial_grid_cell_population(world->spatial_grid, particles->x[i], particles->y[i],
+                                     particles->z[i]) <= config->lod_sparse_count) {
+        tier++;
+    }
+    tiers[tier]++;
+    if (tier == 0) return 1;
+    int interval = config->lod_every_n_frames << (tier - 1);
+    int phase = (world->current_frame + particles->handle_of_slot[i]) % interval;
+    return phase == 0 ? interval : 0;
+}
+
+// Steering from the selected neighbors, or in mean-field mode separation from
+// them and alignment and cohesion from the cell summaries around i.
+static Vector3D steer(const FlockTask* task, int i, const int* neighbors, int count) {
+    const FlockWorld* world = task->world;
+    if (!task->mean_field) {
+        return particle_soa_flock_accel(world->particles, i, neighbors, count,
+                                        &world->leader1, &world->leader2,
+                                        world->config.perception_radius,
+                                        task->separation_weight);
+    }
+    const ParticleSoA* particles = world->particles;
+    Vector3D position = vec3_create(particles->x[i], particles->y[i], particles->z[i]);
+    Vector3D offset_sum, velocity_sum;
+    int field_count = spatial_grid_cell_field(world->spatial_grid, &position,
+                                              particles->group[i],
+                                              world->config.perception_radius, &offset_sum,
+                                              &velocity_sum);
+    return particle_soa_mean_field_accel(particles, i, neighbors, count,
+                                         &offset_sum, &velocity_sum, field_count,
+                                         &world->leader1, &world->leader2,
+                                         world->config.perception_radius,
+                                         task->separation_weight);
+}
+
+// A steering update lasts until the next one: particles coasting a LOD
+// interval keep applying it, so the turn is spread over the interval rather
+// than landing as one impulse interval times the force.
+static void hold_accel(FlockWorld* world, int i, const Vector3D* accel) {
+    float* held = world->neighbor_cache[i].held_accel;
+    held[0] = accel->x;
+    held[1] = accel->y;
+    held[2] = accel->z;
+}
+
+static Vector3D held_accel(const FlockWorld* world, int i) {
+    const float* held = world->neighbor_cache[i].held_accel;
+    return vec3_create(held[0], held[1], held[2]);
+}
+
+static void add_lod_counts(FlockTask* task, const int* tiers, int skipped) {
+    for (int t = 0; t < FLOCK_LOD_TIERS; t++) {
+        atomic_fetch_add(&task->lod_tiers[t], tiers[t]);
+    }
+    atomic_fetch_add(&task->lod_skipped, skipped);
+}
+
+// Reads frame N from particles and writes frame N+1 into particles_back in
+// one pass. Nothing in the front buffer changes until the swap, so chunks
+// can run on any thread in any order.
+static void step_chunk(void* ctx, int begin, int end, int thread_idx) {
+    (void)thread_idx;
+    FlockTask* task = (FlockTask*)ctx;
+    FlockWorld* world = task->world;
+    bool coast = false;
+    int rebuilds = 0;
+    int skipped = 0;
+    int tiers[FLOCK_LOD_TIERS] = {0};
+    trace_begin("flock chunk");
+
+    // Inline pools hand over the whole range at once, so the budget is
+    // still checked chunk by chunk here.
+    for (int chunk = begin; chunk < end; chunk += SIM_CHUNK_SIZE) {
+        int chunk_end = chunk + SIM_CHUNK_SIZE < end ? chunk + SIM_CHUNK_SIZE : end;
+        if (!coast && chunk_over_budget(task, chunk)) {
+            coast = true;
+            defer_range(task, chunk, end);
+        }
+        for (int k = chunk; k < chunk_end; k++) {
+            int i = slot_at(task, k);
+            Vector3D accel = vec3_create(0, 0, 0);
+            int steps = coast ? 0 : lod_steps(task, i, tiers);
+            if (steps > 0) {
+                int neighbors[MAX_NEIGHBORS];
+                int count = 0;
+                rebuilds += refresh_neighbor_cache(world, i, steps, neighbors, &count);
+                accel = steer(task, i, neighbors, count);
+                hold_accel(world, i, &accel);
+            } else if (!coast) {
+                accel = held_accel(world, i);
+                skipped++;
+            }
+            particle_soa_integrate_into(world->particles, world->particles_back, i, &accel,
+                                        world->width, world->height, world->depth);
+        }
+    }
+    atomic_fetch_add(&task->rebuilds, rebuilds);
+    add_lod_counts(task, tiers, skipped);
+    trace_end();
+}
+
+// Without a back buffer a step runs in two phases. Phase 1: each particle
+// reads frame-N positions and writes only its own acceleration and neighbor
+// cache entry, so chunks can run on any thread in any order and the result
+// does not depend on thread count.
+static void flock_chunk(void* ctx, int begin, int end, int thread_idx) {
+    (void)thread_idx;
+    FlockTask* task = (FlockTask*)ctx;
+    FlockWorld* world = task->world;
+    ParticleSoA* particles = world->particles;
+    int rebuilds = 0;
+    int skipped = 0;
+    int tiers[FLOCK_LOD_TIERS] = {0};
+    trace_begin("flock chunk");
+
+    for (int chunk = begin; chunk < end; chunk += SIM_CHUNK_SIZE) {
+        if (chunk_over_budget(task, chunk)) {
+            defer_range(task, chunk, end);
+            break;
+        }
+        int chunk_end = chunk + SIM_CHUNK_SIZE < end ? chunk + SIM_CHUNK_SIZE : end;
+        for (int k = chunk; k < chunk_end; k++) {
+            int i = slot_at(task, k);
+            int steps = lod_steps(task, i, tiers);
+            Vector3D accel;
+            if (steps > 0) {
+                int neighbors[MAX_NEIGHBORS];
+                int count = 0;
+                rebuilds += refresh_neighbor_cache(world, i, steps, neighbors, &count);
+                accel = steer(task, i, neighbors, count);
+                hold_accel(world, i, &accel);
+            } else {
+                accel = held_accel(world, i);
+                skipped++;
+            }
+            particles->ax[i] += accel.x;
+            particles->ay[i] += accel.y;
+            particles->az[i] += accel.z;
+        }
+    }
+    atomic_fetch_add(&task->rebuilds, rebuilds);
+    add_lod_counts(task, tiers, skipped);
+    trace_end();
+}
+
+// Phase 2: integrate once every acceleration for this frame is known.
+static void integrate_chunk(void* ctx, int begin, int end, int thread_idx) {
+    (void)thread_idx;
+    FlockWorld* world = (FlockWorld*)ctx;
+    particle_soa_integrate_range(world->particles, begin, end,
+                                 world->width, world->height, world->depth);
+}
+
+static void update_leaders(FlockWorld* world) {
+    float cx = world->width / 2.0f;
+    float cy = world->height / 2.0f;
+    float cz = world->depth / 2.0f;
+
+    if (world->follow_target) {
+        world->target_leader1 = world->target;
+        world->target_leader2 = world->target;
+    } else {
+        world->leader_angle += LEADER_SPEED;
+        float angle = world->leader_angle;
+        world->target_leader1 = vec3_create(
+            cx + cosf(angle) * ORBIT_RADIUS,
+            cy + sinf(angle) * ORBIT_RADIUS * 0.7f,
+            cz + sinf(angle * 1.5f) * 100.0f);
+        world->target_leader2 = vec3_create(
+            cx + cosf(angle + M_PI) * ORBIT_RADIUS,
+            cy + sinf(angle + M_PI) * ORBIT_RADIUS * 0.7f,
+            cz + cosf(angle * 1.5f) * 100.0f);
+    }
+
+    Vector3D* l1 = &world->leader1;
+    Vector3D* l2 = &world->leader2;
+    l1->x += (world->target_leader1.x - l1->x) * LEADER_INTERPOLATION;
+    l1->y += (world->target_leader1.y - l1->y) * LEADER_INTERPOLATION;
+    l1->z += (world->target_leader1.z - l1->z) * LEADER_INTERPOLATION;
+    l2->x += (world->target_leader2.x - l2->x) * LEADER_INTERPOLATION;
+    l2->y += (world->target_leader2.y - l2->y) * LEADER_INTERPOLATION;
+    l2->z += (world->target_leader2.z - l2->z) * LEADER_INTERPOLATION;
+}
+
+void flock_world_advance_controls(FlockWorld* world, FlockWorldControls* out) {
+    world->separation_time += SEPARATION_OSCILLATION_SPEED;
+    update_leaders(world);
+
+    out->leader1 = world->leader1;
+    out->leader2 = world->leader2;
+    out->separation_weight = 1.1f + sinf(world->separation_time) * 0.3f;
+}
+
+void flock_world_step(FlockWorld* world) {
+    trace_begin("step");
+    double frame_start = get_time_ms();
+#if ENABLE_PROFILING
+    double t1, t2;
+#endif
+
+    FlockWorldControls controls;
+    flock_world_advance_controls(world, &controls);
+    float separation_weight = controls.separation_weight;
+
+#if ENABLE_PROFILING
+    t1 = get_time_ms();
+#endif
+
+    if (world->grid_stale ||
+        world->current_frame % world->config.update_grid_every_n_frames == 0) {
+        world->grid_stale = false;
+        trace_begin("grid");
+        spatial_grid_update_soa_parallel(world->spatial_grid, world->particles,
+                                         world->thread_pool);
+        trace_end();
+        if (world->config.reorder_by_cell) {
+            // Grid-cell order keeps neighbor reads in mostly contiguous memory.
+            trace_begin("reorder");
+            spatial_grid_reorder_soa(world->spatial_grid, world->particles);
+            remap_slot_lists(world);
+            trace_end();
+        }
+    }
+
+#if ENABLE_PROFILING
+    t2 = get_time_ms();
+    world->stats.grid_update_time += (t2 - t1);
+    t1 = t2;
+#endif
+
+    int skin_rebuilds = world->neighbor_skin ? update_skin_lists(world) : 0;
+
+    int count = world->particles->count;
+    // Handles are dense in [0, count), so one check covers a shrunken flock.
+    if (world->budget_handle >= count) world->budget_handle = 0;
+    int cursor = count > 0 ? particle_soa_slot_of(world->particles, world->budget_handle) : 0;
+    FlockTask task = {.world = world, .separation_weight = separation_weight,
+                      .frame_start = frame_start, .cursor = cursor,
+                      .count = count,
+                      .lod = world->config.lod_far_depth < 1.0f ||
+                             world->config.lod_sparse_count > 0,
+                      .mean_field = world->config.mean_field != 0};
+    atomic_init(&task.first_deferred, count);
+    atomic_init(&task.deferred, 0);
+    atomic_init(&task.rebuilds, 0);
+    atomic_init(&task.lod_skipped, 0);
+    for (int t = 0; t < FLOCK_LOD_TIERS; t++) {
+        atomic_init(&task.lod_tiers[t], 0);
+    }
+    trace_begin("flock");
+    if (world->particles_back) {
+        thread_pool_parallel_for(world->thread_pool, count, SIM_CHUNK_SIZE, step_chunk, &task);
+        particle_soa_swap(&world->particles, &world->particles_back);
+    } else {
+        thread_pool_parallel_for(world->thread_pool, count, SIM_CHUNK_SIZE, flock_chunk, &task);
+        thread_pool_parallel_for(world->thread_pool, count, SIM_CHUNK_SIZE, integrate_chunk,
+                                 world);
+    }
+
+    trace_end();
+
+    int deferred = atomic_load(&task.deferred);
+    int rebuilds = atomic_load(&task.rebuilds) + skin_rebuilds;
+    int skipped = atomic_load(&task.lod_skipped);
+    world->stats.particle_updates += count - deferred - skipped;
+    world->stats.neighbor_rebuilds += rebuilds;
+    world->stats.lod_skipped += skipped;
+    for (int t = 0; t < FLOCK_LOD_TIERS; t++) {
+        world->stats.lod_tiers[t] += atomic_load(&task.lod_tiers[t]);
+    }
+    trace_count(TRACE_CACHE_HITS, count - deferred - skipped - rebuilds);
+    if (deferred > 0) {
+        int slot = slot_at(&task, atomic_load(&task.first_deferred));
+        world->budget_handle = world->particles->handle_of_slot[slot];
+        world->stats.deferred_updates += deferred;
+        world->stats.frames_over_budget++;
+    }
+    world->current_frame++;
+
+#if ENABLE_PROFILING
+    t2 = get_time_ms();
+    world->stats.flocking_time += (t2 - t1);
+    t1 = t2;
+#endif
+
+    if (world->config.sort_every_n_frames > 0 &&
+        ++world->frame_counter >= world->config.sort_every_n_frames) {
+        trace_begin("sort");
+        depth_order_update(world->depth_order, world->particles->z, world->depth);
+        trace_end();
+        world->frame_counter = 0;
+    }
+
+#if ENABLE_PROFILING
+    t2 = get_time_ms();
+    world->stats.sorting_time += (t2 - t1);
+    world->stats.total_time += (t2 - frame_start);
+#endif
+    world->stats.frame_count++;
+    trace_flush_counters();
+    trace_end();
+}
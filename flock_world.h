@@ -0,0 +1,98 @@
+#ifndef FLOCK_WORLD_H
+#define FLOCK_WORLD_H
+
+#include <stddef.h>
+#include "flock_config.h"
+#include "particle_soa.h"
+#include "vector3d.h"
+
+// One independent simulation: particles, grid, leaders, neighbor cache and
+// worker threads. Worlds share no state, so a process can run several side
+// by side.
+typedef struct FlockWorld FlockWorld;
+
+typedef struct {
+    float width, height, depth;
+    int threads;    // 0 = one per core, 1 = run inline on the caller
+    unsigned seed;  // seeds the world's RNG; same seed, same flock
+} FlockWorldDesc;
+
+// Per-frame steering inputs shared by every particle.
+typedef struct {
+    Vector3D leader1, leader2;
+    float separation_weight;
+} FlockWorldControls;
+
+// Level-of-detail tiers: 0 steers every step, 1 (far or sparse) every
+// config.lod_every_n_frames steps, 2 (far and sparse) half as often again.
+#define FLOCK_LOD_TIERS 3
+
+// Milliseconds spent in each phase, summed since the last reset.
+typedef struct {
+    double grid_update_time;
+    double flocking_time;
+    double sorting_time;
+    double total_time;
+    int frame_count;
+    long particle_updates;   // particles steered
+    long deferred_updates;   // particles left to coast by max_frame_time_ms
+    int frames_over_budget;  // steps that deferred any
+    long neighbor_rebuilds;  // neighbor lists re-queried; / particle_updates = rebuild rate
+    long lod_tiers[FLOCK_LOD_TIERS];  // particles placed in each tier, summed over steps
+    long lod_skipped;        // particles coasting between their tier's updates
+} FlockWorldStats;
+
+FlockWorld *flock_world_create(const FlockWorldDesc *desc, const FlockConfig *config);
+void flock_world_destroy(FlockWorld *world);
+
+// Advances one frame. Call from one thread at a time per world.
+void flock_world_step(FlockWorld *world);
+
+// Moves the leaders and the separation oscillation on by one frame without
+// touching the particles, for backends that step the flock elsewhere.
+// flock_world_step does this itself.
+void flock_world_advance_controls(FlockWorld *world, FlockWorldControls *out);
+
+// Applies a new config from the next step on, rebuilding only what it
+// invalidates. A particle-count change grows or shrinks the flock in place.
+// Returns -1 and leaves the world as it was if flock_config_validate
+// rejects config.
+int flock_world_set_config(FlockWorld *world, const FlockConfig *config);
+const FlockConfig *flock_world_config(const FlockWorld *world);
+
+// Changes the wrap bounds (and the dense grid with them).
+void flock_world_resize(FlockWorld *world, float width, float height, float depth);
+
+// Both leaders chase target while it is set; NULL resumes their orbit.
+void flock_world_set_target(FlockWorld *world, const Vector3D *target);
+
+// Read-only view of the current frame, valid until the next step or config
+// change. Slots are reordered between frames; use the handle tables to
+// follow one particle.
+const ParticleSoA *flock_world_particles(const FlockWorld *world);
+// Slots of the current frame back to front (count entries), refreshed every
+// config.sort_every_n_frames steps and remapped whenever slots move. NULL
+// when depth ordering is off; draw in slot order then.
+const int *flock_world_depth_order(const FlockWorld *world);
+// Copies up to max interleaved xyz positions into out; returns the count.
+int flock_world_get_positions(const FlockWorld *world, float *out, int max);
+
+const FlockWorldStats *flock_world_stats(const FlockWorld *world);
+void flock_world_reset_stats(FlockWorld *world);
+int flock_world_thread_count(const FlockWorld *world);
+// Heap bytes held by the spatial grid (see config.hashed_grid).
+size_t flock_world_grid_bytes(const FlockWorld *world);
+
+// Snapshots (format in snapshot.h) hold the particles in slot order plus
+// the leaders, separation phase, RNG state and frame number. Save writes
+// one to path, quantized to 16 bits with SNAPSHOT_QUANTIZED in flags.
+// Load replaces the flock with one held in memory: the count follows the
+// snapshot (config.num_particles with it), handles restart dense in slot
+// order, neighbor lists are dropped and the grid is rebuilt once. The
+// _file variant maps path rather than reading it. All return 0 on success,
+// -1 if the file or snapshot is unusable (the world is unchanged then).
+int flock_world_save_snapshot(const FlockWorld *world, const char *path, unsigned flags);
+int flock_world_load_snapshot(FlockWorld *world, const void *data, size_t size);
+int flock_world_load_snapshot_file(FlockWorld *world, const char *path);
+
+#endif
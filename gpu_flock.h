@@ -0,0 +1,38 @@
+#ifndef GPU_FLOCK_H
+#define GPU_FLOCK_H
+
+#include "flock_config.h"
+#include "flock_world.h"
+
+// Optional backend that keeps the flock in GPU buffers and steps it there:
+// cell keys, a bitonic sort by key, per-cell ranges, then neighbor steering
+// and integration. gpu_flock_gl.c does this with GL 4.3 compute shaders,
+// gpu_flock_webgl.c with WebGL2 fragment passes and transform feedback.
+// Positions never come back to the CPU; the renderers draw them from
+// gpu_flock_position_buffer directly.
+//
+// Differences from the CPU step: neighbors are every particle within the
+// perception radius up to GPU_FLOCK_MAX_NEIGHBORS in cell order, not the k
+// nearest, and there is no neighbor cache or frame budget.
+typedef struct GpuFlock GpuFlock;
+
+#define GPU_FLOCK_MAX_NEIGHBORS 64
+
+// Needs a current GL 4.3 (native) or WebGL2 context. Copies the world's
+// particles as the starting state. Returns NULL when the context lacks what
+// the backend needs, so callers can stay on the CPU.
+GpuFlock *gpu_flock_create(const FlockWorld *world);
+void gpu_flock_destroy(GpuFlock *gpu);
+
+// One frame. controls come from flock_world_advance_controls on the world
+// the flock was created from, so the leaders keep moving the same way.
+void gpu_flock_step(GpuFlock *gpu, const FlockWorldControls *controls,
+                    const FlockConfig *config, float width, float height, float depth);
+
+int gpu_flock_count(const GpuFlock *gpu);
+
+// Buffer object holding count vec4 positions (xyz, w unused), valid until
+// the next step.
+unsigned int gpu_flock_position_buffer(const GpuFlock *gpu);
+
+#endif
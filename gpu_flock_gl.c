@@ -0,0 +1,386 @@
+#define GL_GLEXT_PROTOTYPES
+#include "gpu_flock.h"
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LOCAL_SIZE 256
+
+// Storage buffer bindings shared by every pass.
+enum {
+    BIND_POS_IN,
+    BIND_VEL_IN,
+    BIND_POS_OUT,
+    BIND_VEL_OUT,
+    BIND_PAIRS,
+    BIND_CELL_START,
+    BIND_CELL_END
+};
+
+struct GpuFlock {
+    GLuint keys_program;
+    GLuint sort_program;
+    GLuint ranges_program;
+    GLuint steer_program;
+
+    GLuint positions[2];
+    GLuint velocities[2];
+    GLuint pairs;  // (cell key, particle index), padded to a power of two
+    GLuint cell_start;
+    GLuint cell_end;
+    int front;
+
+    int count;
+    int padded;
+    int cell_capacity;
+};
+
+#define STR(x) #x
+#define XSTR(x) STR(x)
+
+// Cells tile the world exactly, so each is at least the perception radius
+// wide and a periodic neighbor is never more than one cell away.
+static const char *common_src =
+    "#version 430\n"
+    "#define LOCAL_SIZE " XSTR(LOCAL_SIZE) "\n"
+    "#define MAX_NEIGHBORS " XSTR(GPU_FLOCK_MAX_NEIGHBORS) "\n"
+    "layout(local_size_x = LOCAL_SIZE) in;\n"
+    "layout(std430, binding = 0) readonly buffer PosIn { vec4 pos_in[]; };\n"
+    "layout(std430, binding = 1) readonly buffer VelIn { vec4 vel_in[]; };\n"
+    "layout(std430, binding = 2) writeonly buffer PosOut { vec4 pos_out[]; };\n"
+    "layout(std430, binding = 3) writeonly buffer VelOut { vec4 vel_out[]; };\n"
+    "layout(std430, binding = 4) buffer Pairs { uvec2 pairs[]; };\n"
+    "layout(std430, binding = 5) buffer CellStart { uint cell_start[]; };\n"
+    "layout(std430, binding = 6) buffer CellEnd { uint cell_end[]; };\n"
+    "uniform uint count;\n"
+    "uniform uint padded;\n"
+    "uniform vec3 bounds;\n"
+    "uniform ivec3 dims;\n"
+    "ivec3 cell_of(vec3 p) {\n"
+    "    return clamp(ivec3(p * vec3(dims) / bounds), ivec3(0), dims - 1);\n"
+    "}\n"
+    "uint key_of(ivec3 c) {\n"
+    "    return uint(c.x + dims.x * (c.y + dims.y * c.z));\n"
+    "}\n";
+
+// Padding sorts after every real key and is never read back.
+static const char *keys_src =
+    "void main() {\n"
+    "    uint i = gl_GlobalInvocationID.x;\n"
+    "    if (i >= padded) return;\n"
+    "    uint key = i < count ? key_of(cell_of(pos_in[i].xyz)) : 0xFFFFFFFFu;\n"
+    "    pairs[i] = uvec2(key, i);\n"
+    "}\n";
+
+// One compare-exchange step of a bitonic sort; ties break on the index so
+// the order is the same every run.
+static const char *sort_src =
+    "uniform uint j;\n"
+    "uniform uint k;\n"
+    "void main() {\n"
+    "    uint i = gl_GlobalInvocationID.x;\n"
+    "    uint l = i ^ j;\n"
+    "    if (i >= padded || l <= i) return;\n"
+    "    uvec2 a = pairs[i];\n"
+    "    uvec2 b = pairs[l];\n"
+    "    bool greater = a.x > b.x || (a.x == b.x && a.y > b.y);\n"
+    "    if (greater == ((i & k) == 0u)) {\n"
+    "        pairs[i] = b;\n"
+    "        pairs[l] = a;\n"
+    "    }\n"
+    "}\n";
+
+// Empty cells keep the cleared start = end = 0.
+static const char *ranges_src =
+    "void main() {\n"
+    "    uint i = gl_GlobalInvocationID.x;\n"
+    "    if (i >= count) return;\n"
+    "    uint key = pairs[i].x;\n"
+    "    if (i == 0u || pairs[i - 1u].x != key) cell_start[key] = i;\n"
+    "    if (i == count - 1u || pairs[i + 1u].x != key) cell_end[key] = i + 1u;\n"
+    "}\n";
+
+// Same rules as soa_steering and particle_soa_integrate_into, with every
+// boid flying as group 0 (set_group_uniforms).
+static const char *steer_src =
+    "uniform float radius_sq;\n"
+    "uniform float max_speed;\n"
+    "uniform float max_force;\n"
+    "uniform float separation_weight;\n"
+    "uniform float alignment_weight;\n"
+    "uniform float cohesion_weight;\n"
+    "uniform float leader_weight;\n"
+    "uniform vec3 leader1;\n"
+    "uniform vec3 leader2;\n"
+    "vec3 steer(vec3 desired, vec3 v) {\n"
+    "    float d_sq = dot(desired, desired);\n"
+    "    vec3 s = (d_sq > 0.0 ? desired * (max_speed * inversesqrt(d_sq)) : vec3(0.0)) - v;\n"
+    "    float s_sq = dot(s, s);\n"
+    "    return s_sq > max_force * max_force ? s * (max_force * inversesqrt(s_sq)) : s;\n"
+    "}\n"
+    "void main() {\n"
+    "    uint i = gl_GlobalInvocationID.x;\n"
+    "    if (i >= count) return;\n"
+    "    vec3 p = pos_in[i].xyz;\n"
+    "    vec3 v = vel_in[i].xyz;\n"
+    "    vec3 separation = vec3(0.0), alignment = vec3(0.0), cohesion = vec3(0.0);\n"
+    "    int total = 0;\n"
+    "    ivec3 c = cell_of(p);\n"
+    "    ivec3 lo = ivec3(greaterThanEqual(dims, ivec3(3))) * -1;\n"
+    "    ivec3 hi = ivec3(greaterThanEqual(dims, ivec3(2)));\n"
+    "    for (int dz = lo.z; dz <= hi.z; dz++)\n"
+    "    for (int dy = lo.y; dy <= hi.y; dy++)\n"
+    "    for (int dx = lo.x; dx <= hi.x; dx++) {\n"
+    "        uint key = key_of((c + ivec3(dx, dy, dz) + dims) % dims);\n"
+    "        for (uint s = cell_start[key]; s < cell_end[key] && total < MAX_NEIGHBORS; s++) {\n"
+    "            uint n = pairs[s].y;\n"
+    "            if (n == i) continue;\n"
+    "            vec3 d = p - pos_in[n].xyz;\n"
+    "            d -= bounds * round(d / bounds);\n"
+    "            float d_sq = dot(d, d);\n"
+    "            if (d_sq < radius_sq && d_sq > 0.001) {\n"
+    "                separation += d / d_sq;\n"
+    "                alignment += vel_in[n].xyz;\n"
+    "                cohesion += p - d;\n"
+    "                total++;\n"
+    "            }\n"
+    "        }\n"
+    "    }\n"
+    "    vec3 accel = vec3(0.0);\n"
+    "    if (total > 0) {\n"
+    "        accel += steer(separation, v) * separation_weight;\n"
+    "        accel += steer(alignment, v) * alignment_weight;\n"
+    "        accel += steer(cohesion / float(total) - p, v) * cohesion_weight;\n"
+    "    }\n"
+    "    vec3 d1 = p - leader1, d2 = p - leader2;\n"
+    "    accel += steer((dot(d1, d1) < dot(d2, d2) ? leader1 : leader2) - p, v) * leader_weight;\n"
+    "    v += accel;\n"
+    "    float v_sq = dot(v, v);\n"
+    "    if (v_sq > max_speed * max_speed) v *= max_speed * inversesqrt(v_sq);\n"
+    "    p += v;\n"
+    "    p = mix(p, vec3(0.0), greaterThan(p, bounds));\n"
+    "    p = mix(p, bounds, lessThan(p, vec3(0.0)));\n"
+    "    pos_out[i] = vec4(p, 1.0);\n"
+    "    vel_out[i] = vec4(v, 0.0);\n"
+    "}\n";
+
+static GLuint build_program(const char* name, const char* body) {
+    const char* sources[] = {common_src, body};
+    GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(shader, 2, sources, NULL);
+    glCompileShader(shader);
+
+    GLint success;
+    char info_log[1024];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader, sizeof(info_log), NULL, info_log);
+        fprintf(stderr, "gpu_flock: %s shader failed: %s\n", name, info_log);
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glDeleteShader(shader);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program, sizeof(info_log), NULL, info_log);
+        fprintf(stderr, "gpu_flock: %s program failed: %s\n", name, info_log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+static GLuint create_buffer(GLsizeiptr size, const void* data) {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_DYNAMIC_COPY);
+    return buffer;
+}
+
+static int next_pow2(int n) {
+    int p = 1;
+    while (p < n) p *= 2;
+    return p;
+}
+
+static GLuint groups(int n) {
+    return (GLuint)((n + LOCAL_SIZE - 1) / LOCAL_SIZE);
+}
+
+GpuFlock* gpu_flock_create(const FlockWorld* world) {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major < 4 || (major == 4 && minor < 3)) {
+        fprintf(stderr, "gpu_flock: needs GL 4.3 compute shaders, context is %d.%d\n",
+                major, minor);
+        return NULL;
+    }
+
+    GpuFlock* gpu = calloc(1, sizeof(GpuFlock));
+    gpu->keys_program = build_program("keys", keys_src);
+    gpu->sort_program = build_program("sort", sort_src);
+    gpu->ranges_program = build_program("ranges", ranges_src);
+    gpu->steer_program = build_program("steer", steer_src);
+    if (!gpu->keys_program || !gpu->sort_program || !gpu->ranges_program ||
+        !gpu->steer_program) {
+        gpu_flock_destroy(gpu);
+        return NULL;
+    }
+
+    const ParticleSoA* particles = flock_world_particles(world);
+    gpu->count = particles->count;
+    gpu->padded = next_pow2(particles->count);
+
+    float* pos = malloc(sizeof(float) * 4 * gpu->count);
+    float* vel = malloc(sizeof(float) * 4 * gpu->count);
+    for (int i = 0; i < gpu->count; i++) {
+        pos[i * 4 + 0] = particles->x[i];
+        pos[i * 4 + 1] = particles->y[i];
+        pos[i * 4 + 2] = particles->z[i];
+        pos[i * 4 + 3] = 1.0f;
+        vel[i * 4 + 0] = particles->vx[i];
+        vel[i * 4 + 1] = particles->vy[i];
+        vel[i * 4 + 2] = particles->vz[i];
+        vel[i * 4 + 3] = 0.0f;
+    }
+    GLsizeiptr state_size = (GLsizeiptr)sizeof(float) * 4 * gpu->count;
+    gpu->positions[0] = create_buffer(state_size, pos);
+    gpu->velocities[0] = create_buffer(state_size, vel);
+    gpu->positions[1] = create_buffer(state_size, NULL);
+    gpu->velocities[1] = create_buffer(state_size, NULL);
+    gpu->pairs = create_buffer((GLsizeiptr)sizeof(uint32_t) * 2 * gpu->padded, NULL);
+    free(pos);
+    free(vel);
+
+    return gpu;
+}
+
+void gpu_flock_destroy(GpuFlock* gpu) {
+    if (!gpu) return;
+    glDeleteProgram(gpu->keys_program);
+    glDeleteProgram(gpu->sort_program);
+    glDeleteProgram(gpu->ranges_program);
+    glDeleteProgram(gpu->steer_program);
+    glDeleteBuffers(2, gpu->positions);
+    glDeleteBuffers(2, gpu->velocities);
+    glDeleteBuffers(1, &gpu->pairs);
+    glDeleteBuffers(1, &gpu->cell_start);
+    glDeleteBuffers(1, &gpu->cell_end);
+    free(gpu);
+}
+
+static void ensure_cells(GpuFlock* gpu, int cells) {
+    if (cells <= gpu->cell_capacity) return;
+    glDeleteBuffers(1, &gpu->cell_start);
+    glDeleteBuffers(1, &gpu->cell_end);
+    gpu->cell_start = create_buffer((GLsizeiptr)sizeof(uint32_t) * cells, NULL);
+    gpu->cell_end = create_buffer((GLsizeiptr)sizeof(uint32_t) * cells, NULL);
+    gpu->cell_capacity = cells;
+}
+
+static void set_common_uniforms(GLuint program, const GpuFlock* gpu,
+                                const float bounds[3], const int dims[3]) {
+    glUseProgram(program);
+    glUniform1ui(glGetUniformLocation(program, "count"), (GLuint)gpu->count);
+    glUniform1ui(glGetUniformLocation(program, "padded"), (GLuint)gpu->padded);
+    glUniform3f(glGetUniformLocation(program, "bounds"), bounds[0], bounds[1], bounds[2]);
+    glUniform3i(glGetUniformLocation(program, "dims"), dims[0], dims[1], dims[2]);
+}
+
+// The shaders fly every boid as group 0, so its constants go in as uniforms
+// each step and config edits take effect live. A fixed leader is passed as
+// both leaders so the shader's nearest pick always lands on it.
+static void set_group_uniforms(GLuint steer, const FlockConfig* config,
+                               const FlockWorldControls* controls) {
+    const FlockGroup* g = &config->groups[0];
+    float radius = config->perception_radius;
+    if (g->perception_radius > 0.0f && g->perception_radius < radius) radius = g->perception_radius;
+    const Vector3D* leader1 = g->leader == FLOCK_LEADER_SECOND ? &controls->leader2 : &controls->leader1;
+    const Vector3D* leader2 = g->leader == FLOCK_LEADER_FIRST ? &controls->leader1 : &controls->leader2;
+    glUniform1f(glGetUniformLocation(steer, "radius_sq"), radius * radius);
+    glUniform1f(glGetUniformLocation(steer, "max_speed"), g->max_speed);
+    glUniform1f(glGetUniformLocation(steer, "max_force"), g->max_force);
+    glUniform1f(glGetUniformLocation(steer, "separation_weight"),
+                controls->separation_weight * g->separation_weight);
+    glUniform1f(glGetUniformLocation(steer, "alignment_weight"), g->alignment_weight);
+    glUniform1f(glGetUniformLocation(steer, "cohesion_weight"), g->cohesion_weight);
+    glUniform1f(glGetUniformLocation(steer, "leader_weight"), g->leader_weight);
+    glUniform3f(glGetUniformLocation(steer, "leader1"), leader1->x, leader1->y, leader1->z);
+    glUniform3f(glGetUniformLocation(steer, "leader2"), leader2->x, leader2->y, leader2->z);
+}
+
+void gpu_flock_step(GpuFlock* gpu, const FlockWorldControls* controls,
+                    const FlockConfig* config, float width, float height, float depth) {
+    float bounds[3] = {width, height, depth};
+    float cell_size = config->perception_radius * config->grid_cell_ratio;
+    if (cell_size < config->perception_radius) cell_size = config->perception_radius;
+    int dims[3];
+    for (int a = 0; a < 3; a++) {
+        dims[a] = (int)floorf(bounds[a] / cell_size);
+        if (dims[a] < 1) dims[a] = 1;
+    }
+    int cells = dims[0] * dims[1] * dims[2];
+    ensure_cells(gpu, cells);
+
+    int front = gpu->front;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_POS_IN, gpu->positions[front]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_VEL_IN, gpu->velocities[front]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_POS_OUT, gpu->positions[1 - front]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_VEL_OUT, gpu->velocities[1 - front]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_PAIRS, gpu->pairs);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_CELL_START, gpu->cell_start);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_CELL_END, gpu->cell_end);
+
+    set_common_uniforms(gpu->keys_program, gpu, bounds, dims);
+    glDispatchCompute(groups(gpu->padded), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    set_common_uniforms(gpu->sort_program, gpu, bounds, dims);
+    GLint j_loc = glGetUniformLocation(gpu->sort_program, "j");
+    GLint k_loc = glGetUniformLocation(gpu->sort_program, "k");
+    for (GLuint k = 2; k <= (GLuint)gpu->padded; k <<= 1) {
+        for (GLuint j = k >> 1; j > 0; j >>= 1) {
+            glUniform1ui(j_loc, j);
+            glUniform1ui(k_loc, k);
+            glDispatchCompute(groups(gpu->padded), 1, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+    }
+
+    GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gpu->cell_start);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gpu->cell_end);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    set_common_uniforms(gpu->ranges_program, gpu, bounds, dims);
+    glDispatchCompute(groups(gpu->count), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    GLuint steer = gpu->steer_program;
+    set_common_uniforms(steer, gpu, bounds, dims);
+    set_group_uniforms(steer, config, controls);
+    glDispatchCompute(groups(gpu->count), 1, 1);
+
+    // The next step reads these as storage; the renderer as vertex input.
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    gpu->front = 1 - front;
+}
+
+int gpu_flock_count(const GpuFlock* gpu) {
+    return gpu->count;
+}
+
+unsigned int gpu_flock_position_buffer(const GpuFlock* gpu) {
+    return gpu->positions[gpu->front];
+}
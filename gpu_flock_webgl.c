@@ -0,0 +1,512 @@
+#include "gpu_flock.h"
+#include <GLES3/gl3.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// WebGL2 has no compute or storage buffers, so every pass is either a
+// fragment pass into an integer texture or a transform feedback pass:
+//   state buffers -> state textures (pixel unpack, stays on the GPU)
+//   keys:   fragment pass writing (cell key, index) per particle
+//   sort:   one fragment pass per bitonic step, ping-ponging two textures
+//   ranges: fragment pass per cell, binary search for its [start, end)
+//   steer:  transform feedback writing the next positions and velocities
+// 2048 is the smallest MAX_TEXTURE_SIZE WebGL2 allows.
+#define MAX_TEXTURE_WIDTH 2048
+
+typedef struct {
+    GLuint texture;
+    GLuint framebuffer;
+    int width, height;
+} Target;
+
+struct GpuFlock {
+    GLuint keys_program;
+    GLuint sort_program;
+    GLuint ranges_program;
+    GLuint steer_program;
+    GLuint vao;  // empty: every pass generates its vertices from gl_VertexID
+
+    GLuint positions[2];
+    GLuint velocities[2];
+    int front;
+    GLuint position_texture;
+    GLuint velocity_texture;
+    int state_width, state_height;
+
+    Target sorted[2];  // RG32UI (key, index), padded to a power of two
+    Target cells;      // RG32UI (start, end) per cell
+    int cell_capacity;
+
+    int count;
+    int padded;
+};
+
+// compile_shader prepends the #version line to every source.
+static const char *fullscreen_vs =
+    "void main() {\n"
+    "    vec2 p = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));\n"
+    "    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *empty_fs =
+    "void main() {}\n";
+
+// Cells tile the world exactly, so each is at least the perception radius
+// wide and a periodic neighbor is never more than one cell away.
+static const char *common_src =
+    "precision highp float;\n"
+    "precision highp int;\n"
+    "precision highp usampler2D;\n"
+    "uniform highp sampler2D positions;\n"
+    "uniform highp sampler2D velocities;\n"
+    "uniform usampler2D sorted;\n"
+    "uniform usampler2D cells;\n"
+    "uniform int count;\n"
+    "uniform vec3 bounds;\n"
+    "uniform ivec3 dims;\n"
+    "ivec2 texel(int i, int width) { return ivec2(i % width, i / width); }\n"
+    "vec3 position_of(int i) {\n"
+    "    return texelFetch(positions, texel(i, textureSize(positions, 0).x), 0).xyz;\n"
+    "}\n"
+    "vec3 velocity_of(int i) {\n"
+    "    return texelFetch(velocities, texel(i, textureSize(velocities, 0).x), 0).xyz;\n"
+    "}\n"
+    "uvec2 pair_at(int i) {\n"
+    "    return texelFetch(sorted, texel(i, textureSize(sorted, 0).x), 0).xy;\n"
+    "}\n"
+    "ivec3 cell_of(vec3 p) {\n"
+    "    return clamp(ivec3(p * vec3(dims) / bounds), ivec3(0), dims - 1);\n"
+    "}\n"
+    "int key_of(ivec3 c) { return c.x + dims.x * (c.y + dims.y * c.z); }\n";
+
+// Fragment passes write one texel per entry, row-major in a width-wide texture.
+static const char *fragment_src =
+    "int fragment_index(int width) {\n"
+    "    ivec2 p = ivec2(gl_FragCoord.xy);\n"
+    "    return p.y * width + p.x;\n"
+    "}\n";
+
+// Padding sorts after every real key and is never read back.
+static const char *keys_fs =
+    "out uvec4 result;\n"
+    "uniform int width;\n"
+    "void main() {\n"
+    "    int i = fragment_index(width);\n"
+    "    uint key = i < count ? uint(key_of(cell_of(position_of(i)))) : 0xFFFFFFFFu;\n"
+    "    result = uvec4(key, uint(i), 0u, 0u);\n"
+    "}\n";
+
+// One compare-exchange step of a bitonic sort, written from both sides:
+// the lower slot keeps the smaller pair when ascending. Ties break on the
+// index so the order is the same every run.
+static const char *sort_fs =
+    "out uvec4 result;\n"
+    "uniform int width;\n"
+    "uniform int j;\n"
+    "uniform int k;\n"
+    "void main() {\n"
+    "    int i = fragment_index(width);\n"
+    "    int l = i ^ j;\n"
+    "    uvec2 a = pair_at(i);\n"
+    "    uvec2 b = pair_at(l);\n"
+    "    bool a_greater = a.x > b.x || (a.x == b.x && a.y > b.y);\n"
+    "    bool keep_min = (i < l) == ((i & k) == 0);\n"
+    "    result = uvec4(a_greater == keep_min ? b : a, 0u, 0u);\n"
+    "}\n";
+
+// First sorted slot whose key is >= key.
+static const char *ranges_fs =
+    "out uvec4 result;\n"
+    "uniform int width;\n"
+    "int lower_bound(uint key) {\n"
+    "    int lo = 0, hi = count;\n"
+    "    while (lo < hi) {\n"
+    "        int mid = (lo + hi) / 2;\n"
+    "        if (pair_at(mid).x < key) lo = mid + 1; else hi = mid;\n"
+    "    }\n"
+    "    return lo;\n"
+    "}\n"
+    "void main() {\n"
+    "    uint c = uint(fragment_index(width));\n"
+    "    result = uvec4(uint(lower_bound(c)), uint(lower_bound(c + 1u)), 0u, 0u);\n"
+    "}\n";
+
+// Same rules as soa_steering and particle_soa_integrate_into, with every
+// boid flying as group 0 (set_group_uniforms).
+static const char *steer_vs =
+    "#define MAX_NEIGHBORS %d\n"
+    "uniform float radius_sq;\n"
+    "uniform float max_speed;\n"
+    "uniform float max_force;\n"
+    "uniform float separation_weight;\n"
+    "uniform float alignment_weight;\n"
+    "uniform float cohesion_weight;\n"
+    "uniform float leader_weight;\n"
+    "uniform vec3 leader1;\n"
+    "uniform vec3 leader2;\n"
+    "out vec4 out_pos;\n"
+    "out vec4 out_vel;\n"
+    "vec3 steer(vec3 desired, vec3 v) {\n"
+    "    float d_sq = dot(desired, desired);\n"
+    "    vec3 s = (d_sq > 0.0 ? desired * (max_speed * inversesqrt(d_sq)) : vec3(0.0)) - v;\n"
+    "    float s_sq = dot(s, s);\n"
+    "    return s_sq > max_force * max_force ? s * (max_force * inversesqrt(s_sq)) : s;\n"
+    "}\n"
+    "void main() {\n"
+    "    int i = gl_VertexID;\n"
+    "    vec3 p = position_of(i);\n"
+    "    vec3 v = velocity_of(i);\n"
+    "    vec3 separation = vec3(0.0), alignment = vec3(0.0), cohesion = vec3(0.0);\n"
+    "    int total = 0;\n"
+    "    ivec3 c = cell_of(p);\n"
+    "    ivec3 lo = -ivec3(greaterThanEqual(dims, ivec3(3)));\n"
+    "    ivec3 hi = ivec3(greaterThanEqual(dims, ivec3(2)));\n"
+    "    int cell_width = textureSize(cells, 0).x;\n"
+    "    for (int dz = lo.z; dz <= hi.z; dz++)\n"
+    "    for (int dy = lo.y; dy <= hi.y; dy++)\n"
+    "    for (int dx = lo.x; dx <= hi.x; dx++) {\n"
+    "        int key = key_of((c + ivec3(dx, dy, dz) + dims) %% dims);\n"
+    "        uvec2 range = texelFetch(cells, texel(key, cell_width), 0).xy;\n"
+    "        for (int s = int(range.x); s < int(range.y) && total < MAX_NEIGHBORS; s++) {\n"
+    "            int n = int(pair_at(s).y);\n"
+    "            if (n == i) continue;\n"
+    "            vec3 d = p - position_of(n);\n"
+    "            d -= bounds * floor(d / bounds + 0.5);\n"
+    "            float d_sq = dot(d, d);\n"
+    "            if (d_sq < radius_sq && d_sq > 0.001) {\n"
+    "                separation += d / d_sq;\n"
+    "                alignment += velocity_of(n);\n"
+    "                cohesion += p - d;\n"
+    "                total++;\n"
+    "            }\n"
+    "        }\n"
+    "    }\n"
+    "    vec3 accel = vec3(0.0);\n"
+    "    if (total > 0) {\n"
+    "        accel += steer(separation, v) * separation_weight;\n"
+    "        accel += steer(alignment, v) * alignment_weight;\n"
+    "        accel += steer(cohesion / float(total) - p, v) * cohesion_weight;\n"
+    "    }\n"
+    "    vec3 d1 = p - leader1, d2 = p - leader2;\n"
+    "    accel += steer((dot(d1, d1) < dot(d2, d2) ? leader1 : leader2) - p, v) * leader_weight;\n"
+    "    v += accel;\n"
+    "    float v_sq = dot(v, v);\n"
+    "    if (v_sq > max_speed * max_speed) v *= max_speed * inversesqrt(v_sq);\n"
+    "    p += v;\n"
+    "    p = mix(p, vec3(0.0), greaterThan(p, bounds));\n"
+    "    p = mix(p, bounds, lessThan(p, vec3(0.0)));\n"
+    "    out_pos = vec4(p, 1.0);\n"
+    "    out_vel = vec4(v, 0.0);\n"
+    "}\n";
+
+static GLuint compile_shader(GLenum type, const char* common, const char* stage,
+                             const char* body) {
+    const char* sources[] = {"#version 300 es\n", common, stage, body};
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 4, sources, NULL);
+    glCompileShader(shader);
+
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char info_log[1024];
+        glGetShaderInfoLog(shader, sizeof(info_log), NULL, info_log);
+        fprintf(stderr, "gpu_flock: shader compilation failed: %s\n", info_log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static GLuint link_program(GLuint vs, GLuint fs, int feedback) {
+    if (!vs || !fs) {
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    if (feedback) {
+        const char* varyings[] = {"out_pos", "out_vel"};
+        glTransformFeedbackVaryings(program, 2, varyings, GL_SEPARATE_ATTRIBS);
+    }
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char info_log[1024];
+        glGetProgramInfoLog(program, sizeof(info_log), NULL, info_log);
+        fprintf(stderr, "gpu_flock: program linking failed: %s\n", info_log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+static GLuint fragment_pass_program(const char* body) {
+    return link_program(compile_shader(GL_VERTEX_SHADER, "", "", fullscreen_vs),
+                        compile_shader(GL_FRAGMENT_SHADER, common_src, fragment_src, body), 0);
+}
+
+static GLuint steer_program(void) {
+    char body[8192];
+    snprintf(body, sizeof(body), steer_vs, GPU_FLOCK_MAX_NEIGHBORS);
+    return link_program(compile_shader(GL_VERTEX_SHADER, common_src, "", body),
+                        compile_shader(GL_FRAGMENT_SHADER, "", "", empty_fs),
+                        1);
+}
+
+static GLuint create_texture(GLenum internal_format, int width, int height) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, internal_format, width, height);
+    // Integer and unfiltered float textures are only complete with NEAREST.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return texture;
+}
+
+static void create_target(Target* t, int entries) {
+    t->width = entries < MAX_TEXTURE_WIDTH ? entries : MAX_TEXTURE_WIDTH;
+    t->height = (entries + t->width - 1) / t->width;
+    t->texture = create_texture(GL_RG32UI, t->width, t->height);
+    glGenFramebuffers(1, &t->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, t->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, t->texture, 0);
+}
+
+static void destroy_target(Target* t) {
+    glDeleteFramebuffers(1, &t->framebuffer);
+    glDeleteTextures(1, &t->texture);
+    memset(t, 0, sizeof(*t));
+}
+
+static GLuint create_buffer(GLsizeiptr size, const void* data) {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, size, data, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return buffer;
+}
+
+static int next_pow2(int n) {
+    int p = 1;
+    while (p < n) p *= 2;
+    return p;
+}
+
+GpuFlock* gpu_flock_create(const FlockWorld* world) {
+    GpuFlock* gpu = calloc(1, sizeof(GpuFlock));
+    gpu->keys_program = fragment_pass_program(keys_fs);
+    gpu->sort_program = fragment_pass_program(sort_fs);
+    gpu->ranges_program = fragment_pass_program(ranges_fs);
+    gpu->steer_program = steer_program();
+    if (!gpu->keys_program || !gpu->sort_program || !gpu->ranges_program ||
+        !gpu->steer_program) {
+        gpu_flock_destroy(gpu);
+        return NULL;
+    }
+    glGenVertexArrays(1, &gpu->vao);
+
+    const ParticleSoA* particles = flock_world_particles(world);
+    gpu->count = particles->count;
+    gpu->padded = next_pow2(particles->count);
+
+    // State buffers cover the whole state texture so one unpack fills it.
+    gpu->state_width = gpu->count < MAX_TEXTURE_WIDTH ? gpu->count : MAX_TEXTURE_WIDTH;
+    gpu->state_height = (gpu->count + gpu->state_width - 1) / gpu->state_width;
+    int slots = gpu->state_width * gpu->state_height;
+    float* pos = calloc((size_t)slots * 4, sizeof(float));
+    float* vel = calloc((size_t)slots * 4, sizeof(float));
+    for (int i = 0; i < gpu->count; i++) {
+        pos[i * 4 + 0] = particles->x[i];
+        pos[i * 4 + 1] = particles->y[i];
+        pos[i * 4 + 2] = particles->z[i];
+        pos[i * 4 + 3] = 1.0f;
+        vel[i * 4 + 0] = particles->vx[i];
+        vel[i * 4 + 1] = particles->vy[i];
+        vel[i * 4 + 2] = particles->vz[i];
+    }
+    GLsizeiptr state_size = (GLsizeiptr)sizeof(float) * 4 * slots;
+    gpu->positions[0] = create_buffer(state_size, pos);
+    gpu->velocities[0] = create_buffer(state_size, vel);
+    gpu->positions[1] = create_buffer(state_size, NULL);
+    gpu->velocities[1] = create_buffer(state_size, NULL);
+    free(pos);
+    free(vel);
+
+    gpu->position_texture = create_texture(GL_RGBA32F, gpu->state_width, gpu->state_height);
+    gpu->velocity_texture = create_texture(GL_RGBA32F, gpu->state_width, gpu->state_height);
+    create_target(&gpu->sorted[0], gpu->padded);
+    create_target(&gpu->sorted[1], gpu->padded);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return gpu;
+}
+
+void gpu_flock_destroy(GpuFlock* gpu) {
+    if (!gpu) return;
+    glDeleteProgram(gpu->keys_program);
+    glDeleteProgram(gpu->sort_program);
+    glDeleteProgram(gpu->ranges_program);
+    glDeleteProgram(gpu->steer_program);
+    glDeleteVertexArrays(1, &gpu->vao);
+    glDeleteBuffers(2, gpu->positions);
+    glDeleteBuffers(2, gpu->velocities);
+    glDeleteTextures(1, &gpu->position_texture);
+    glDeleteTextures(1, &gpu->velocity_texture);
+    destroy_target(&gpu->sorted[0]);
+    destroy_target(&gpu->sorted[1]);
+    destroy_target(&gpu->cells);
+    free(gpu);
+}
+
+static void ensure_cells(GpuFlock* gpu, int cells) {
+    if (cells <= gpu->cell_capacity) return;
+    destroy_target(&gpu->cells);
+    create_target(&gpu->cells, cells);
+    gpu->cell_capacity = cells;
+}
+
+static void upload_state(GLuint buffer, GLuint texture, int width, int height) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_FLOAT, (void*)0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+// Texture units: 0 positions, 1 velocities, 2 sorted pairs, 3 cell ranges.
+static void use_program(GLuint program, const GpuFlock* gpu,
+                        const float bounds[3], const int dims[3]) {
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "positions"), 0);
+    glUniform1i(glGetUniformLocation(program, "velocities"), 1);
+    glUniform1i(glGetUniformLocation(program, "sorted"), 2);
+    glUniform1i(glGetUniformLocation(program, "cells"), 3);
+    glUniform1i(glGetUniformLocation(program, "count"), gpu->count);
+    glUniform3f(glGetUniformLocation(program, "bounds"), bounds[0], bounds[1], bounds[2]);
+    glUniform3i(glGetUniformLocation(program, "dims"), dims[0], dims[1], dims[2]);
+}
+
+// The shaders fly every boid as group 0, so its constants go in as uniforms
+// each step and config edits take effect live. A fixed leader is passed as
+// both leaders so the shader's nearest pick always lands on it.
+static void set_group_uniforms(GLuint steer, const FlockConfig* config,
+                               const FlockWorldControls* controls) {
+    const FlockGroup* g = &config->groups[0];
+    float radius = config->perception_radius;
+    if (g->perception_radius > 0.0f && g->perception_radius < radius) radius = g->perception_radius;
+    const Vector3D* leader1 = g->leader == FLOCK_LEADER_SECOND ? &controls->leader2 : &controls->leader1;
+    const Vector3D* leader2 = g->leader == FLOCK_LEADER_FIRST ? &controls->leader1 : &controls->leader2;
+    glUniform1f(glGetUniformLocation(steer, "radius_sq"), radius * radius);
+    glUniform1f(glGetUniformLocation(steer, "max_speed"), g->max_speed);
+    glUniform1f(glGetUniformLocation(steer, "max_force"), g->max_force);
+    glUniform1f(glGetUniformLocation(steer, "separation_weight"),
+                controls->separation_weight * g->separation_weight);
+    glUniform1f(glGetUniformLocation(steer, "alignment_weight"), g->alignment_weight);
+    glUniform1f(glGetUniformLocation(steer, "cohesion_weight"), g->cohesion_weight);
+    glUniform1f(glGetUniformLocation(steer, "leader_weight"), g->leader_weight);
+    glUniform3f(glGetUniformLocation(steer, "leader1"), leader1->x, leader1->y, leader1->z);
+    glUniform3f(glGetUniformLocation(steer, "leader2"), leader2->x, leader2->y, leader2->z);
+}
+
+static void bind_texture(int unit, GLuint texture) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+static void draw_into(const Target* t, GLuint program) {
+    glBindFramebuffer(GL_FRAMEBUFFER, t->framebuffer);
+    glViewport(0, 0, t->width, t->height);
+    glUniform1i(glGetUniformLocation(program, "width"), t->width);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void gpu_flock_step(GpuFlock* gpu, const FlockWorldControls* controls,
+                    const FlockConfig* config, float width, float height, float depth) {
+    float bounds[3] = {width, height, depth};
+    float cell_size = config->perception_radius * config->grid_cell_ratio;
+    if (cell_size < config->perception_radius) cell_size = config->perception_radius;
+    int dims[3];
+    for (int a = 0; a < 3; a++) {
+        dims[a] = (int)floorf(bounds[a] / cell_size);
+        if (dims[a] < 1) dims[a] = 1;
+    }
+    ensure_cells(gpu, dims[0] * dims[1] * dims[2]);
+
+    // The front-end's viewport, blending and bindings are restored at the end.
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_BLEND);
+    glBindVertexArray(gpu->vao);
+
+    int front = gpu->front;
+    upload_state(gpu->positions[front], gpu->position_texture, gpu->state_width, gpu->state_height);
+    upload_state(gpu->velocities[front], gpu->velocity_texture, gpu->state_width, gpu->state_height);
+    bind_texture(0, gpu->position_texture);
+    bind_texture(1, gpu->velocity_texture);
+
+    use_program(gpu->keys_program, gpu, bounds, dims);
+    draw_into(&gpu->sorted[0], gpu->keys_program);
+
+    int src = 0;
+    use_program(gpu->sort_program, gpu, bounds, dims);
+    GLint j_loc = glGetUniformLocation(gpu->sort_program, "j");
+    GLint k_loc = glGetUniformLocation(gpu->sort_program, "k");
+    for (int k = 2; k <= gpu->padded; k <<= 1) {
+        for (int j = k >> 1; j > 0; j >>= 1) {
+            bind_texture(2, gpu->sorted[src].texture);
+            glUniform1i(j_loc, j);
+            glUniform1i(k_loc, k);
+            draw_into(&gpu->sorted[1 - src], gpu->sort_program);
+            src = 1 - src;
+        }
+    }
+    bind_texture(2, gpu->sorted[src].texture);
+
+    use_program(gpu->ranges_program, gpu, bounds, dims);
+    draw_into(&gpu->cells, gpu->ranges_program);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    bind_texture(3, gpu->cells.texture);
+
+    GLuint steer = gpu->steer_program;
+    use_program(steer, gpu, bounds, dims);
+    set_group_uniforms(steer, config, controls);
+
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, gpu->positions[1 - front]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 1, gpu->velocities[1 - front]);
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, gpu->count);
+    glEndTransformFeedback();
+    glDisable(GL_RASTERIZER_DISCARD);
+    // WebGL rejects a buffer bound for feedback and as vertex input at once.
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 1, 0);
+
+    for (int unit = 3; unit >= 0; unit--) {
+        bind_texture(unit, 0);
+    }
+    glBindVertexArray(0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (blend) glEnable(GL_BLEND);
+    gpu->front = 1 - front;
+}
+
+int gpu_flock_count(const GpuFlock* gpu) {
+    return gpu->count;
+}
+
+unsigned int gpu_flock_position_buffer(const GpuFlock* gpu) {
+    return gpu->positions[gpu->front];
+}
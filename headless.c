@@ -0,0 +1,214 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "flock_config.h"
+#include "flock_world.h"
+#include "snapshot.h"
+#include "trace.h"
+#include "trajectory.h"
+
+#define WIDTH 800
+#define HEIGHT 600
+#define DEPTH 600.0f
+#define MAX_WORLDS 64
+
+typedef struct {
+    int frames;
+    int worlds;
+    int threads;
+    unsigned seed;
+    const char* trace_path;  // NULL = no trace
+    const char* load_snapshot;  // every world starts from it
+    const char* save_snapshot;  // world 0 after the run
+    unsigned snapshot_flags;
+    const char* record_path;  // trajectory of world 0
+} RunOptions;
+
+static double get_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Order-independent digest of the final positions, so runs can be compared
+// across thread counts and builds.
+static double position_checksum(const FlockWorld* world) {
+    const ParticleSoA* particles = flock_world_particles(world);
+    double sum = 0.0;
+    for (int i = 0; i < particles->count; i++) {
+        sum += particles->x[i] + 2.0 * particles->y[i] + 3.0 * particles->z[i];
+    }
+    return sum;
+}
+
+// Runner flags are taken out of argv; whatever is left goes to the config.
+static int parse_run_options(RunOptions* opts, int* argc, char** argv) {
+    int kept = 1;
+    for (int i = 1; i < *argc; i++) {
+        const char* flags[] = {"--frames", "--worlds", "--threads", "--seed"};
+        int matched = -1;
+        for (int f = 0; f < 4; f++) {
+            if (strcmp(argv[i], flags[f]) == 0) matched = f;
+        }
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < *argc) {
+            opts->trace_path = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--load-snapshot") == 0 && i + 1 < *argc) {
+            opts->load_snapshot = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--save-snapshot") == 0 && i + 1 < *argc) {
+            opts->save_snapshot = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < *argc) {
+            opts->record_path = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--quantize-snapshot") == 0) {
+            opts->snapshot_flags |= SNAPSHOT_QUANTIZED;
+            continue;
+        }
+        if (matched < 0) {
+            argv[kept++] = argv[i];
+            continue;
+        }
+        if (i + 1 >= *argc) {
+            fprintf(stderr, "%s needs a value\n", argv[i]);
+            return -1;
+        }
+        long value = strtol(argv[++i], NULL, 10);
+        switch (matched) {
+        case 0: opts->frames = (int)value; break;
+        case 1: opts->worlds = (int)value; break;
+        case 2: opts->threads = (int)value; break;
+        case 3: opts->seed = (unsigned)value; break;
+        }
+    }
+    *argc = kept;
+
+    if (opts->frames < 1 || opts->worlds < 1 || opts->worlds > MAX_WORLDS) {
+        fprintf(stderr, "--frames must be >= 1 and --worlds in [1, %d]\n", MAX_WORLDS);
+        return -1;
+    }
+    return 0;
+}
+
+static void destroy_worlds(FlockWorld** worlds, int count) {
+    for (int w = 0; w < count; w++) {
+        flock_world_destroy(worlds[w]);
+    }
+}
+
+int main(int argc, char** argv) {
+    RunOptions opts = {.frames = 600, .worlds = 1, .threads = 0, .seed = 1};
+    FlockConfig config;
+    flock_config_defaults(&config);
+
+    if (parse_run_options(&opts, &argc, argv) != 0 ||
+        flock_config_parse_args(&config, argc, argv) != 0) {
+        fprintf(stderr, "Usage: %s [--frames n] [--worlds n] [--threads n] [--seed n] "
+                        "[--trace file.json] [--load-snapshot file] [--save-snapshot file "
+                        "[--quantize-snapshot]] [--record file] [--config file] [--key value ...]\n",
+                argv[0]);
+        return 1;
+    }
+
+    FlockWorld* worlds[MAX_WORLDS];
+    for (int w = 0; w < opts.worlds; w++) {
+        FlockWorldDesc desc = {.width = WIDTH, .height = HEIGHT, .depth = DEPTH,
+                               .threads = opts.threads, .seed = opts.seed + w};
+        worlds[w] = flock_world_create(&desc, &config);
+    }
+    if (opts.load_snapshot) {
+        double load_start = get_time_ms();
+        for (int w = 0; w < opts.worlds; w++) {
+            if (flock_world_load_snapshot_file(worlds[w], opts.load_snapshot) != 0) {
+                fprintf(stderr, "can't load snapshot %s\n", opts.load_snapshot);
+                destroy_worlds(worlds, opts.worlds);
+                return 1;
+            }
+        }
+        config = *flock_world_config(worlds[0]);
+        printf("Loaded %s in %.2f ms\n", opts.load_snapshot, get_time_ms() - load_start);
+    }
+
+    printf("Headless flock: %d world(s) x %d particles, %d frames, %s kernel, %d threads\n",
+           opts.worlds, config.num_particles, opts.frames, particle_soa_simd_name(),
+           flock_world_thread_count(worlds[0]));
+
+    if (opts.trace_path) {
+        trace_set_thread_name("main");
+        trace_set_enabled(1);
+    }
+    TrajectoryRecorder* recorder = NULL;
+    if (opts.record_path) {
+        recorder = trajectory_recorder_create(opts.record_path, WIDTH, HEIGHT, DEPTH,
+                                              TRAJECTORY_CHUNK_FRAMES);
+        if (!recorder) fprintf(stderr, "can't write %s\n", opts.record_path);
+    }
+    double start = get_time_ms();
+    for (int frame = 0; frame < opts.frames; frame++) {
+        for (int w = 0; w < opts.worlds; w++) {
+            flock_world_step(worlds[w]);
+        }
+        if (recorder) {
+            trajectory_recorder_push(recorder, flock_world_particles(worlds[0]), frame);
+        }
+    }
+    double elapsed = get_time_ms() - start;
+    TrajectoryStats recorded = {0};
+    if (recorder && trajectory_recorder_destroy(recorder, &recorded) != 0) {
+        fprintf(stderr, "can't write %s\n", opts.record_path);
+    }
+    if (recorder) {
+        int count = flock_world_particles(worlds[0])->count;
+        double step_ms = flock_world_stats(worlds[0])->total_time;
+        printf("recorded %ld frames (%ld dropped) to %s: %.2f bytes/particle/frame, "
+               "push %.1f%% of step time\n",
+               recorded.frames, recorded.dropped, opts.record_path,
+               (double)recorded.bytes / ((double)recorded.frames * count),
+               100.0 * recorded.push_ms / step_ms);
+    }
+    if (opts.trace_path) {
+        trace_set_enabled(0);
+        if (trace_write_chrome_json(opts.trace_path) != 0) {
+            fprintf(stderr, "can't write %s\n", opts.trace_path);
+        }
+    }
+
+    if (opts.save_snapshot &&
+        flock_world_save_snapshot(worlds[0], opts.save_snapshot, opts.snapshot_flags) != 0) {
+        fprintf(stderr, "can't write %s\n", opts.save_snapshot);
+    }
+
+    for (int w = 0; w < opts.worlds; w++) {
+        const FlockWorldStats* stats = flock_world_stats(worlds[w]);
+        int count = flock_world_particles(worlds[w])->count;
+        double per_frame = stats->total_time / stats->frame_count;
+        printf("world %d: %.3f ms/frame (grid %.3f, flock %.3f, sort %.3f), "
+               "%.1f ns/particle, %ld deferred, %.1f%% lists rebuilt, checksum %.6e\n",
+               w, per_frame,
+               stats->grid_update_time / stats->frame_count,
+               stats->flocking_time / stats->frame_count,
+               stats->sorting_time / stats->frame_count,
+               per_frame * 1e6 / count, stats->deferred_updates,
+               100.0 * stats->neighbor_rebuilds / stats->particle_updates,
+               position_checksum(worlds[w]));
+        long placed = stats->lod_tiers[0] + stats->lod_tiers[1] + stats->lod_tiers[2];
+        if (placed > stats->lod_tiers[0]) {
+            printf("world %d: LOD tiers %.1f%% / %.1f%% / %.1f%%, %.1f%% of updates skipped\n",
+                   w, 100.0 * stats->lod_tiers[0] / placed, 100.0 * stats->lod_tiers[1] / placed,
+                   100.0 * stats->lod_tiers[2] / placed, 100.0 * stats->lod_skipped / placed);
+        }
+    }
+    destroy_worlds(worlds, opts.worlds);
+
+    printf("wall: %.1f ms total, %.3f ms/frame across all worlds\n",
+           elapsed, elapsed / opts.frames);
+    return 0;
+}
@@ -1,37 +1,29 @@
 #define _POSIX_C_SOURCE 199309L
-#include <GL/gl.h>
-#include <GL/glu.h>
 #include <GLFW/glfw3.h>
-#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
-#include "particle.h"
+#include "flock_config.h"
+#include "flock_world.h"
+#include "gpu_flock.h"
+#include "renderer_gl.h"
+#include "sim_thread.h"
+#include "trace.h"
+#include "trajectory.h"
 #include "vector3d.h"
-#include "spatial_grid.h"
-
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
 
 #define WIDTH 800
 #define HEIGHT 600
 #define DEPTH 600.0f
-#define NUM_PARTICLES 500
-#define PERCEPTION_RADIUS 50.0f
-#define ORBIT_RADIUS 250.0f
-#define LEADER_SPEED 0.015f
-#define LEADER_INTERPOLATION 0.05f
-#define SEPARATION_OSCILLATION_SPEED 0.01f
-#define SORT_EVERY_N_FRAMES 0
-#define UPDATE_GRID_EVERY_N_FRAMES 1
-#define CACHE_NEIGHBORS_FRAMES 2
-#define STAGGER_CACHE_UPDATES 1
-#define MAX_FRAME_TIME_MS 10.0f
+#define SIM_THREADS 0  // 0 = one per core
+#define SIM_RATE_HZ 60.0  // fixed step; rendering runs at whatever vsync gives
 #define ENABLE_PROFILING 1
 #define ENABLE_VSYNC 1
+#define TRACE_PATH "flock_trace.json"
+#define SNAPSHOT_PATH "flock_snapshot.bin"
 
 typedef struct {
     bool follow_cursor;
@@ -39,46 +31,19 @@ typedef struct {
 } AppState;
 
 AppState app_state;
-Particle* particles;
-SpatialGrid* spatial_grid;
-Vector3D leader1, leader2;
-Vector3D target_leader1, target_leader2;
-float leader_angle = 0.0f;
-float separation_time = 0.0f;
-int frame_counter = 0;
-int grid_update_counter = 0;
-
-typedef struct {
-    int neighbors[MAX_NEIGHBORS];
-    int count;
-    int frame_cached;
-} NeighborCache;
-NeighborCache* neighbor_cache;
-int current_frame = 0;
-
-#if ENABLE_PROFILING
-typedef struct {
-    double grid_update_time;
-    double flocking_time;
-    double sorting_time;
-    double total_time;
-    int frame_count;
-} ProfilingData;
-
-ProfilingData profiling = {0};
-
-double get_time_ms() {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
-}
-#endif
-
-int compare_particles_by_z(const void* a, const void* b) {
-    const Particle* pa = (const Particle*)a;
-    const Particle* pb = (const Particle*)b;
-    return (pb->position.z > pa->position.z) - (pb->position.z < pa->position.z);
-}
+FlockWorld* world;
+SimThread* sim;
+RendererGL* renderer;
+GpuFlock* gpu;
+bool gpu_unavailable;
+bool backend_stale = true;  // config changed since sync_backend last ran
+double gpu_due;
+uint64_t drawn_frame;       // newest sim frame render() has drawn
+uint64_t profile_frame = 120;
+TrajectoryRecorder* recorder;
+TrajectoryPlayer* player;
+ParticleSoA* playback;
+double playback_due;
 
 void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
     (void)window;
@@ -97,196 +62,229 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action,
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, GLFW_TRUE);
     }
-}
-
-void init_simulation() {
-    srand(time(NULL));
-
-    particles = malloc(sizeof(Particle) * NUM_PARTICLES);
-    for (int i = 0; i < NUM_PARTICLES; i++) {
-        particles[i] = particle_create(
-            ((float)rand() / RAND_MAX) * WIDTH,
-            ((float)rand() / RAND_MAX) * HEIGHT,
-            ((float)rand() / RAND_MAX) * DEPTH);
+    if ((key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD ||
+         key == GLFW_KEY_MINUS || key == GLFW_KEY_KP_SUBTRACT) && action == GLFW_PRESS) {
+        sim_thread_lock(sim);
+        FlockConfig next = *flock_world_config(world);
+        bool grow = key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD;
+        if (grow) {
+            next.num_particles = next.num_particles > MAX_CONFIG_PARTICLES / 2
+                                     ? MAX_CONFIG_PARTICLES
+                                     : next.num_particles * 2;
+        } else if (next.num_particles > 1) {
+            next.num_particles /= 2;
+        }
+        flock_world_set_config(world, &next);
+        backend_stale = true;
+        printf("Particles: %d\n", flock_world_particles(world)->count);
+        sim_thread_unlock(sim);
+    }
+    if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        sim_thread_lock(sim);
+        FlockConfig next = *flock_world_config(world);
+        next.gpu_backend = !next.gpu_backend;
+        flock_world_set_config(world, &next);
+        backend_stale = true;
+        sim_thread_unlock(sim);
+    }
+    if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+        if (!trace_is_enabled()) {
+            trace_set_enabled(1);
+            printf("Tracing: ON\n");
+        } else {
+            // With the sim locked no thread is recording.
+            sim_thread_lock(sim);
+            trace_set_enabled(0);
+            int status = trace_write_chrome_json(TRACE_PATH);
+            sim_thread_unlock(sim);
+            printf(status == 0 ? "Tracing: OFF, wrote %s\n" : "Tracing: OFF, can't write %s\n",
+                   TRACE_PATH);
+        }
+    }
+    // Saves the CPU flock; the GPU backend's state is never read back.
+    if (key == GLFW_KEY_S && action == GLFW_PRESS) {
+        sim_thread_lock(sim);
+        int status = flock_world_save_snapshot(world, SNAPSHOT_PATH, 0);
+        sim_thread_unlock(sim);
+        printf(status == 0 ? "Wrote %s\n" : "Can't write %s\n", SNAPSHOT_PATH);
     }
-
-    spatial_grid = spatial_grid_create(WIDTH, HEIGHT, DEPTH,
-                                       PERCEPTION_RADIUS * 2.0f, NUM_PARTICLES);
-
-    neighbor_cache = calloc(NUM_PARTICLES, sizeof(NeighborCache));
-
-    leader1 = vec3_create(WIDTH / 2.0f, HEIGHT / 2.0f, DEPTH / 2.0f);
-    leader2 = vec3_create(WIDTH / 2.0f, HEIGHT / 2.0f, DEPTH / 2.0f);
-    target_leader1 = leader1;
-    target_leader2 = leader2;
-
-    app_state.follow_cursor = false;
-    app_state.mouse_pos = vec3_create(WIDTH / 2.0f, HEIGHT / 2.0f, DEPTH / 2.0f);
 }
 
-void update_simulation() {
-#if ENABLE_PROFILING
-    double frame_start = get_time_ms();
-    double t1, t2;
-#endif
-
-    separation_time += SEPARATION_OSCILLATION_SPEED;
-    float separation_weight = 1.1f + sinf(separation_time) * 0.3f;
-
-    if (app_state.follow_cursor) {
-        target_leader1 = vec3_copy(&app_state.mouse_pos);
-        target_leader2 = vec3_copy(&app_state.mouse_pos);
-    } else {
-        leader_angle += LEADER_SPEED;
-        target_leader1 = vec3_create(
-            WIDTH / 2.0f + cosf(leader_angle) * ORBIT_RADIUS,
-            HEIGHT / 2.0f + sinf(leader_angle) * ORBIT_RADIUS * 0.7f,
-            DEPTH / 2.0f + sinf(leader_angle * 1.5f) * 100.0f);
-        target_leader2 = vec3_create(
-            WIDTH / 2.0f + cosf(leader_angle + M_PI) * ORBIT_RADIUS,
-            HEIGHT / 2.0f + sinf(leader_angle + M_PI) * ORBIT_RADIUS * 0.7f,
-            DEPTH / 2.0f + cosf(leader_angle * 1.5f) * 100.0f);
+// Switching on uploads the CPU flock as it is; switching off resumes the CPU
+// flock from where it was left, since GPU state is never read back. A count
+// change restarts the GPU flock from the CPU one. The sim thread sits idle
+// while the GPU steps. Call with the sim locked.
+void sync_backend() {
+    const FlockConfig* config = flock_world_config(world);
+    bool want_gpu = config->gpu_backend && !gpu_unavailable;
+    if (gpu && (!want_gpu || gpu_flock_count(gpu) != flock_world_particles(world)->count)) {
+        gpu_flock_destroy(gpu);
+        gpu = NULL;
+        if (!want_gpu) printf("Backend: CPU\n");
     }
-
-    leader1.x += (target_leader1.x - leader1.x) * LEADER_INTERPOLATION;
-    leader1.y += (target_leader1.y - leader1.y) * LEADER_INTERPOLATION;
-    leader1.z += (target_leader1.z - leader1.z) * LEADER_INTERPOLATION;
-    leader2.x += (target_leader2.x - leader2.x) * LEADER_INTERPOLATION;
-    leader2.y += (target_leader2.y - leader2.y) * LEADER_INTERPOLATION;
-    leader2.z += (target_leader2.z - leader2.z) * LEADER_INTERPOLATION;
-
-#if ENABLE_PROFILING
-    t1 = get_time_ms();
-#endif
-
-    if (current_frame % UPDATE_GRID_EVERY_N_FRAMES == 0) {
-        spatial_grid_update(spatial_grid, particles, NUM_PARTICLES);
+    if (want_gpu && !gpu) {
+        gpu = gpu_flock_create(world);
+        gpu_unavailable = gpu == NULL;
+        gpu_due = sim_thread_now();
+        printf("Backend: %s\n", gpu ? "GPU compute" : "CPU (no GL 4.3 compute)");
     }
+    sim_thread_set_paused(sim, gpu != NULL);
+}
 
 #if ENABLE_PROFILING
-    t2 = get_time_ms();
-    profiling.grid_update_time += (t2 - t1);
-    t1 = t2;
-#endif
-
-    int particles_updated = 0;
-    for (int i = 0; i < NUM_PARTICLES; i++) {
-#if ENABLE_PROFILING
-        double elapsed = get_time_ms() - frame_start;
-        if (elapsed > MAX_FRAME_TIME_MS && particles_updated > NUM_PARTICLES / 2) {
-            break;
+// Call with the sim locked.
+void report_profile() {
+    const FlockWorldStats* profiling = flock_world_stats(world);
+    if (profiling->frame_count >= 120) {
+        printf("\n=== Performance Profile (120 frames) ===\n");
+        printf("Grid Update:  %.2f ms/frame (%.1f%%)\n",
+               profiling->grid_update_time / profiling->frame_count,
+               100.0 * profiling->grid_update_time / profiling->total_time);
+        printf("Flocking:     %.2f ms/frame (%.1f%%)\n",
+               profiling->flocking_time / profiling->frame_count,
+               100.0 * profiling->flocking_time / profiling->total_time);
+        printf("Sorting:      %.2f ms/frame (%.1f%%)\n",
+               profiling->sorting_time / profiling->frame_count,
+               100.0 * profiling->sorting_time / profiling->total_time);
+        printf("Total:        %.2f ms/frame (%.1f FPS)\n",
+               profiling->total_time / profiling->frame_count,
+               1000.0 / (profiling->total_time / profiling->frame_count));
+        printf("Deferred:     %.0f updates/frame (%d frames over budget)\n",
+               (double)profiling->deferred_updates / profiling->frame_count,
+               profiling->frames_over_budget);
+        printf("Neighbors:    %.1f%% of lists rebuilt\n",
+               100.0 * profiling->neighbor_rebuilds / profiling->particle_updates);
+        long placed = profiling->lod_tiers[0] + profiling->lod_tiers[1] + profiling->lod_tiers[2];
+        if (placed > profiling->lod_tiers[0]) {
+            printf("LOD tiers:    %.1f%% / %.1f%% / %.1f%% (%.1f%% skipped)\n",
+                   100.0 * profiling->lod_tiers[0] / placed,
+                   100.0 * profiling->lod_tiers[1] / placed,
+                   100.0 * profiling->lod_tiers[2] / placed,
+                   100.0 * profiling->lod_skipped / placed);
         }
-#endif
-
-        int* neighbors;
-        int neighbor_count;
-
-#if STAGGER_CACHE_UPDATES
-        int stagger_group = i % CACHE_NEIGHBORS_FRAMES;
-        int should_update = (current_frame % CACHE_NEIGHBORS_FRAMES) == stagger_group;
-        int needs_init = (current_frame < CACHE_NEIGHBORS_FRAMES && neighbor_cache[i].count == 0);
+        printf("======================================\n\n");
 
-        if (should_update || needs_init) {
-#else
-        if (current_frame - neighbor_cache[i].frame_cached >= CACHE_NEIGHBORS_FRAMES) {
+        flock_world_reset_stats(world);
+    }
+}
 #endif
-            spatial_grid_query_neighbors(spatial_grid, particles,
-                                          &particles[i].position, PERCEPTION_RADIUS,
-                                          &neighbors, &neighbor_count);
 
-            neighbor_cache[i].count = neighbor_count;
-            for (int j = 0; j < neighbor_count && j < MAX_NEIGHBORS; j++) {
-                neighbor_cache[i].neighbors[j] = neighbors[j];
+// The CPU flock steps on the sim thread; this only posts it the cursor, and
+// runs the GPU backend's steps on the GL thread at the same fixed rate. The
+// sim is locked only while the backend changes or the GPU steps, and every
+// 120 drawn frames for the profile.
+void update_simulation() {
+    const Vector3D* target = app_state.follow_cursor ? &app_state.mouse_pos : NULL;
+    sim_thread_set_target(sim, target);
+    if (backend_stale || gpu) {
+        sim_thread_lock(sim);
+        if (backend_stale) sync_backend();
+        backend_stale = false;
+        if (gpu) {
+            flock_world_set_target(world, target);
+            double now = sim_thread_now();
+            if (now - gpu_due > 4.0 / SIM_RATE_HZ) gpu_due = now;
+            while (gpu_due <= now) {
+                FlockWorldControls controls;
+                flock_world_advance_controls(world, &controls);
+                gpu_flock_step(gpu, &controls, flock_world_config(world), WIDTH, HEIGHT,
+                               DEPTH);
+                gpu_due += 1.0 / SIM_RATE_HZ;
             }
-            neighbor_cache[i].frame_cached = current_frame;
         }
-
-        neighbors = neighbor_cache[i].neighbors;
-        neighbor_count = neighbor_cache[i].count;
-
-        particle_flock_optimized(&particles[i], i, particles, neighbors, neighbor_count,
-                                &leader1, &leader2, PERCEPTION_RADIUS, separation_weight);
-        particle_update(&particles[i]);
-        particle_wrap(&particles[i], WIDTH, HEIGHT, DEPTH);
-        particles_updated++;
+        sim_thread_unlock(sim);
     }
 
-    current_frame++;
-
 #if ENABLE_PROFILING
-    t2 = get_time_ms();
-    profiling.flocking_time += (t2 - t1);
-    t1 = t2;
-#endif
-
-#if SORT_EVERY_N_FRAMES > 0
-    frame_counter++;
-    if (frame_counter >= SORT_EVERY_N_FRAMES) {
-        qsort(particles, NUM_PARTICLES, sizeof(Particle), compare_particles_by_z);
-        frame_counter = 0;
+    if (!gpu && drawn_frame >= profile_frame) {
+        sim_thread_lock(sim);
+        report_profile();
+        sim_thread_unlock(sim);
+        profile_frame = drawn_frame + 120;
     }
 #endif
+}
 
-#if ENABLE_PROFILING
-    t2 = get_time_ms();
-    profiling.sorting_time += (t2 - t1);
-
-    profiling.total_time += (t2 - frame_start);
-    profiling.frame_count++;
-
-    if (profiling.frame_count >= 120) {
-        printf("\n=== Performance Profile (120 frames) ===\n");
-        printf("Grid Update:  %.2f ms/frame (%.1f%%)\n",
-               profiling.grid_update_time / profiling.frame_count,
-               100.0 * profiling.grid_update_time / profiling.total_time);
-        printf("Flocking:     %.2f ms/frame (%.1f%%)\n",
-               profiling.flocking_time / profiling.frame_count,
-               100.0 * profiling.flocking_time / profiling.total_time);
-        printf("Sorting:      %.2f ms/frame (%.1f%%)\n",
-               profiling.sorting_time / profiling.frame_count,
-               100.0 * profiling.sorting_time / profiling.total_time);
-        printf("Total:        %.2f ms/frame (%.1f FPS)\n",
-               profiling.total_time / profiling.frame_count,
-               1000.0 / (profiling.total_time / profiling.frame_count));
-        printf("======================================\n\n");
-
-        profiling.grid_update_time = 0;
-        profiling.flocking_time = 0;
-        profiling.sorting_time = 0;
-        profiling.total_time = 0;
-        profiling.frame_count = 0;
+// Playback stands in for the sim: recorded frames are drawn at the rate
+// they were stepped, from the start again once the file runs out.
+void update_playback() {
+    double now = sim_thread_now();
+    if (now - playback_due > 4.0 / SIM_RATE_HZ) playback_due = now;
+    while (playback_due <= now) {
+        if (trajectory_player_next(player, playback) < 0) {
+            trajectory_player_rewind(player);
+            if (trajectory_player_next(player, playback) < 0) break;
+        }
+        playback_due += 1.0 / SIM_RATE_HZ;
     }
-#endif
 }
 
-void render_particle(const Particle* p) {
-    float gray = (p->position.z / DEPTH) * 0.863f;
-    glColor3f(gray, gray, gray);
-
-    float size = 1.0f + ((DEPTH - p->position.z) / DEPTH) * 2.0f;
-
-    glPointSize(size);
-    glBegin(GL_POINTS);
-    glVertex2f(p->position.x, p->position.y);
-    glEnd();
+void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    (void)window;
+    glViewport(0, 0, width, height);
 }
 
 void render() {
+    trace_begin("render");
     glClear(GL_COLOR_BUFFER_BIT);
-
-    for (int i = 0; i < NUM_PARTICLES; i++) {
-        render_particle(&particles[i]);
+    if (player) {
+        renderer_gl_draw(renderer, playback, NULL);
+    } else if (gpu) {
+        renderer_gl_draw_buffer(renderer, gpu_flock_position_buffer(gpu), gpu_flock_count(gpu));
+    } else {
+        const SimView* view = sim_thread_view(sim);
+        renderer_gl_draw(renderer, view->particles, view->order);
+        drawn_frame = view->frame;
     }
+    trace_end();
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // --snapshot, --record and --play are taken out of argv; the rest goes
+    // to the config.
+    const char* snapshot_path = NULL;
+    const char* record_path = NULL;
+    const char* play_path = NULL;
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--play") == 0 && i + 1 < argc) {
+            play_path = argv[++i];
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+
+    FlockConfig config;
+    flock_config_defaults(&config);
+    if (flock_config_parse_args(&config, argc, argv) != 0) {
+        fprintf(stderr, "Usage: %s [--snapshot file] [--record file | --play file] "
+                        "[--config file] [--key value ...]\n", argv[0]);
+        flock_config_print(&config, stderr);
+        return 1;
+    }
+
     if (!glfwInit()) {
         fprintf(stderr, "Failed to initialize GLFW\n");
         return -1;
     }
 
+    // 4.3 for the compute backend; the renderer alone needs 3.3.
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     GLFWwindow* window =
         glfwCreateWindow(WIDTH, HEIGHT, "Flocking Simulation", NULL, NULL);
+    if (!window) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(WIDTH, HEIGHT, "Flocking Simulation", NULL, NULL);
+    }
     if (!window) {
         fprintf(stderr, "Failed to create window\n");
         glfwTerminate();
@@ -301,37 +299,94 @@ int main() {
     glfwSwapInterval(0);
 #endif
 
+    trace_set_thread_name("main");
     glfwSetCursorPosCallback(window, cursor_position_callback);
     glfwSetKeyCallback(window, key_callback);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluOrtho2D(0, WIDTH, HEIGHT, 0);
-    glMatrixMode(GL_MODELVIEW);
-
+    // The viewport maps the simulation bounds, so HiDPI framebuffers that
+    // are larger than the window still show the whole flock.
+    int fb_width, fb_height;
+    glfwGetFramebufferSize(window, &fb_width, &fb_height);
+    glViewport(0, 0, fb_width, fb_height);
     glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-    glEnable(GL_POINT_SMOOTH);
-    glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    init_simulation();
+    renderer = renderer_gl_create(WIDTH, HEIGHT, DEPTH, glfwGetProcAddress);
+    if (!renderer) {
+        fprintf(stderr, "Failed to create the GL 3.3 renderer\n");
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return -1;
+    }
+
+    FlockWorldDesc desc = {.width = WIDTH, .height = HEIGHT, .depth = DEPTH,
+                           .threads = SIM_THREADS, .seed = (unsigned)time(NULL)};
+    world = flock_world_create(&desc, &config);
+    if (snapshot_path && flock_world_load_snapshot_file(world, snapshot_path) != 0) {
+        fprintf(stderr, "Can't load snapshot %s, starting from random\n", snapshot_path);
+    }
+    sim = sim_thread_create(world, 1.0 / SIM_RATE_HZ);
+    if (play_path) {
+        player = trajectory_player_open(play_path);
+        if (!player) fprintf(stderr, "Can't play %s, simulating instead\n", play_path);
+    }
+    if (player) {
+        float width, height, depth;
+        trajectory_player_bounds(player, &width, &height, &depth);
+        renderer_gl_set_bounds(renderer, width, height, depth);
+        playback = particle_soa_create(1);
+        playback_due = sim_thread_now();
+        sim_thread_lock(sim);
+        sim_thread_set_paused(sim, 1);
+        sim_thread_unlock(sim);
+    } else if (record_path) {
+        // Steps run on the sim thread, so that is where frames are pushed.
+        // GPU steps aren't recorded; switching back starts a new chunk.
+        recorder = trajectory_recorder_create(record_path, WIDTH, HEIGHT, DEPTH,
+                                              TRAJECTORY_CHUNK_FRAMES);
+        if (!recorder) fprintf(stderr, "Can't record to %s\n", record_path);
+        sim_thread_lock(sim);
+        sim_thread_set_recorder(sim, recorder);
+        sim_thread_unlock(sim);
+    }
+    app_state.follow_cursor = false;
+    app_state.mouse_pos = vec3_create(WIDTH / 2.0f, HEIGHT / 2.0f, DEPTH / 2.0f);
 
-    printf("Flocking Simulation\n");
+    printf("Flocking Simulation (%s kernel, %d threads, %s buffer)\n",
+           particle_soa_simd_name(), flock_world_thread_count(world),
+           renderer_gl_is_persistent(renderer) ? "persistent" : "orphaned");
     printf("Press SPACE to toggle cursor following\n");
+    printf("Press +/- to double/halve the particle count\n");
+    printf("Press G to toggle the GPU compute backend\n");
+    printf("Press T to start tracing, again to write %s\n", TRACE_PATH);
+    printf("Press S to save a snapshot to %s\n", SNAPSHOT_PATH);
     printf("Press ESC to exit\n");
 
     while (!glfwWindowShouldClose(window)) {
-        update_simulation();
+        if (player) {
+            update_playback();
+        } else {
+            update_simulation();
+        }
         render();
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
-    spatial_grid_destroy(spatial_grid);
-    free(neighbor_cache);
-    free(particles);
+    sim_thread_destroy(sim);
+    if (recorder) {
+        TrajectoryStats stats;
+        int status = trajectory_recorder_destroy(recorder, &stats);
+        printf(status == 0 ? "Recorded %ld frames (%ld dropped), %ld bytes to %s\n"
+                           : "Recorded %ld frames (%ld dropped), %ld bytes; writing %s failed\n",
+               stats.frames, stats.dropped, stats.bytes, record_path);
+    }
+    trajectory_player_close(player);
+    if (playback) particle_soa_destroy(playback);
+    gpu_flock_destroy(gpu);
+    renderer_gl_destroy(renderer);
+    flock_world_destroy(world);
     glfwDestroyWindow(window);
     glfwTerminate();
 
@@ -1,37 +1,28 @@
 #include <GLES2/gl2.h>
 #include <emscripten.h>
+#include <emscripten/heap.h>
 #include <emscripten/html5.h>
-#include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-#include "particle.h"
-#include "spatial_grid.h"
+#include "flock_config.h"
+#include "flock_world.h"
+#include "gpu_flock.h"
+#include "sim_thread.h"
+#include "trace.h"
 #include "vector3d.h"
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
 #define WIDTH 800
 #define HEIGHT 600
 #define DEPTH 600.0f
-#define NUM_PARTICLES 500
+#define SIM_RATE_HZ 60.0  // fixed step; requestAnimationFrame sets the draw rate
 
 int current_width = WIDTH;
 int current_height = HEIGHT;
-#define PERCEPTION_RADIUS 50.0f
-#define ORBIT_RADIUS 250.0f
-#define LEADER_SPEED 0.015f
-#define LEADER_INTERPOLATION 0.05f
-#define SEPARATION_OSCILLATION_SPEED 0.01f
-#define SORT_EVERY_N_FRAMES 3
-#define UPDATE_GRID_EVERY_N_FRAMES 2
-#define CACHE_NEIGHBORS_FRAMES 3
-#define STAGGER_CACHE_UPDATES 1
 
 typedef struct {
   bool follow_cursor;
@@ -39,43 +30,90 @@ typedef struct {
 } AppState;
 
 AppState app_state;
-Particle *particles;
-SpatialGrid *spatial_grid;
-Vector3D leader1, leader2;
-Vector3D target_leader1, target_leader2;
-float leader_angle = 0.0f;
-float separation_time = 0.0f;
-int frame_counter = 0;
+FlockConfig config;
+bool config_ready = false;
+FlockWorld *world;
+SimThread *sim;
+GpuFlock *gpu;
+bool gpu_unavailable = false;
+bool backend_stale = true;  // config or bounds changed since sync_backend last ran
+double gpu_due;
+
+// One vertex per boid: x / width, y / height and z / depth as unsigned
+// normalized 16-bit values, 6 bytes instead of the old 24. The staging
+// array and the GPU buffer are both sized to vertex_capacity and reused.
+typedef struct {
+  uint16_t x, y, z;
+} PackedVertex;
+
+PackedVertex *vertex_data;
+int vertex_capacity = 0;
+
+// The flock as JS sees it, refreshed by render every frame and read in
+// place through flock_state (Module.flockState() in flock_loader.js wraps
+// it). Every field is 32 bits so JS can read it out of HEAPU32. The arrays
+// belong to the sim's view, which owns them, so they only move when it grows.
+typedef struct {
+  uint32_t generation;        // changes whenever JS must rebuild its views
+  int32_t count;              // 0 while the GPU backend runs
+  int32_t stride;             // floats from one particle to the next
+  const float *x, *y, *z;     // drawn positions, by handle
+  const float *vx, *vy, *vz;  // newest step's velocities, by handle
+} StateExport;
+
+StateExport state_export;
+size_t state_heap_size;
 
 GLuint program;
 GLuint vbo;
 GLint position_attrib;
-GLint color_attrib;
-GLint size_attrib;
-GLint resolution_uniform;
-
-const char *vertex_shader_src = "attribute vec2 position;\n"
-                                "attribute vec3 color;\n"
-                                "attribute float size;\n"
-                                "uniform vec2 resolution;\n"
-                                "varying vec3 vColor;\n"
+GLint scale_uniform;
+
+// Closer = darker and bigger; farther = lighter grey and smaller. scale is
+// 1 for packed vertices and 1 / bounds for the GPU backend's float positions.
+const char *vertex_shader_src = "attribute vec3 position;\n"
+                                "uniform vec3 scale;\n"
+                                "varying float vGray;\n"
                                 "void main() {\n"
-                                "    gl_Position = vec4(position.x / (resolution.x * 0.5) - "
-                                "1.0, 1.0 - position.y / (resolution.y * 0.5), 0.0, 1.0);\n"
-                                "    gl_PointSize = size;\n"
-                                "    vColor = color;\n"
+                                "    vec3 p = position * scale;\n"
+                                "    gl_Position = vec4(p.x * 2.0 - 1.0, "
+                                "1.0 - p.y * 2.0, 0.0, 1.0);\n"
+                                "    gl_PointSize = 1.5 + (1.0 - p.z) * 3.0;\n"
+                                "    vGray = p.z * 0.5;\n"
                                 "}\n";
 
 const char *fragment_shader_src = "precision mediump float;\n"
-                                  "varying vec3 vColor;\n"
+                                  "varying float vGray;\n"
                                   "void main() {\n"
-                                  "    gl_FragColor = vec4(vColor, 1.0);\n"
+                                  "    gl_FragColor = vec4(vec3(vGray), 1.0);\n"
                                   "}\n";
 
-int compare_particles_by_z(const void *a, const void *b) {
-  const Particle *pa = (const Particle *)a;
-  const Particle *pb = (const Particle *)b;
-  return (pb->position.z > pa->position.z) - (pb->position.z < pa->position.z);
+// JS may set values before main runs, so defaults are filled in on first use.
+// The browser default keeps a depth order (an index sort, refreshed every
+// frame); the rest match native.
+void ensure_config() {
+  if (config_ready)
+    return;
+  flock_config_defaults(&config);
+  config.sort_every_n_frames = 1;
+  config_ready = true;
+}
+
+// Before the world exists this only records the values init will use.
+// Returns -1, keeping the current config, if the world rejects next.
+int apply_config(const FlockConfig *next) {
+  if (!world) {
+    if (flock_config_validate(next) != 0)
+      return -1;
+    config = *next;
+    return 0;
+  }
+  sim_thread_lock(sim);
+  int status = flock_world_set_config(world, next);
+  config = *flock_world_config(world);
+  sim_thread_unlock(sim);
+  backend_stale = true;
+  return status;
 }
 
 EM_BOOL mouse_callback(int eventType, const EmscriptenMouseEvent *e,
@@ -89,6 +127,14 @@ EM_BOOL mouse_callback(int eventType, const EmscriptenMouseEvent *e,
   return EM_TRUE;
 }
 
+// Spans and counters go to performance.measure / performance.mark as they
+// happen; record in the DevTools performance panel to see them.
+EMSCRIPTEN_KEEPALIVE
+void set_tracing(int enabled) {
+  trace_set_enabled(enabled);
+  printf("Tracing: %s\n", enabled ? "ON" : "OFF");
+}
+
 EM_BOOL key_callback(int eventType, const EmscriptenKeyboardEvent *e,
                      void *userData) {
   (void)userData;
@@ -99,6 +145,16 @@ EM_BOOL key_callback(int eventType, const EmscriptenKeyboardEvent *e,
       printf("Follow cursor: %s\n", app_state.follow_cursor ? "ON" : "OFF");
       return EM_TRUE;
     }
+    if (strcmp(e->code, "KeyG") == 0) {
+      FlockConfig next = config;
+      next.gpu_backend = !next.gpu_backend;
+      apply_config(&next);
+      return EM_TRUE;
+    }
+    if (strcmp(e->code, "KeyT") == 0) {
+      set_tracing(!trace_is_enabled());
+      return EM_TRUE;
+    }
   }
   return EM_FALSE;
 }
@@ -141,11 +197,10 @@ void init_gl() {
   glDeleteShader(fragment_shader);
 
   position_attrib = glGetAttribLocation(program, "position");
-  color_attrib = glGetAttribLocation(program, "color");
-  size_attrib = glGetAttribLocation(program, "size");
-  resolution_uniform = glGetUniformLocation(program, "resolution");
+  scale_uniform = glGetUniformLocation(program, "scale");
 
   glGenBuffers(1, &vbo);
+  glEnableVertexAttribArray(position_attrib);
 
   glClearColor(0.99f, 0.98f, 0.94f, 1.0f);  // Oyster white
   glEnable(GL_BLEND);
@@ -153,22 +208,14 @@ void init_gl() {
 }
 
 void init_simulation() {
-  srand(time(NULL));
-
-  particles = malloc(sizeof(Particle) * NUM_PARTICLES);
-  for (int i = 0; i < NUM_PARTICLES; i++) {
-    particles[i] = particle_create(((float)rand() / RAND_MAX) * current_width,
-                                   ((float)rand() / RAND_MAX) * current_height,
-                                   ((float)rand() / RAND_MAX) * DEPTH);
-  }
-
-  spatial_grid = spatial_grid_create(current_width, current_height, DEPTH,
-                                     PERCEPTION_RADIUS * 1.5f, NUM_PARTICLES);
-
-  leader1 = vec3_create(current_width / 2.0f, current_height / 2.0f, DEPTH / 2.0f);
-  leader2 = vec3_create(current_width / 2.0f, current_height / 2.0f, DEPTH / 2.0f);
-  target_leader1 = leader1;
-  target_leader2 = leader2;
+  // The default wasm build has no pthreads: one thread, the step runs
+  // inline and main_loop pumps the sim. The wasm-mt build steps it on a
+  // worker with a pool of one thread per core.
+  FlockWorldDesc desc = {.width = current_width, .height = current_height,
+                         .depth = DEPTH, .threads = 0,
+                         .seed = (unsigned)time(NULL)};
+  world = flock_world_create(&desc, &config);
+  sim = sim_thread_create(world, 1.0 / SIM_RATE_HZ);
 
   app_state.follow_cursor = false;
   app_state.mouse_pos = vec3_create(current_width / 2.0f, current_height / 2.0f, DEPTH / 2.0f);
@@ -177,106 +224,157 @@ void init_simulation() {
   emscripten_set_keydown_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, NULL, 1,
                                   key_callback);
 
-  printf("Flocking Simulation (WebAssembly)\n");
+  printf("Flocking Simulation (WebAssembly, %s kernel, %d threads)\n",
+         particle_soa_simd_name(), flock_world_thread_count(world));
   printf("Press SPACE to toggle cursor following\n");
+  printf("Press G to toggle the WebGL2 GPU backend\n");
+  printf("Press T to toggle tracing to the DevTools performance panel\n");
 }
 
-void update_simulation() {
-  separation_time += SEPARATION_OSCILLATION_SPEED;
-  float separation_weight = 1.1f + sinf(separation_time) * 0.3f;
-
-  if (app_state.follow_cursor) {
-    target_leader1 = vec3_copy(&app_state.mouse_pos);
-    target_leader2 = vec3_copy(&app_state.mouse_pos);
-  } else {
-    leader_angle += LEADER_SPEED;
-    target_leader1 =
-        vec3_create(current_width / 2.0f + cosf(leader_angle) * ORBIT_RADIUS,
-                    current_height / 2.0f + sinf(leader_angle) * ORBIT_RADIUS * 0.7f,
-                    DEPTH / 2.0f + sinf(leader_angle * 1.5f) * 100.0f);
-    target_leader2 = vec3_create(
-        current_width / 2.0f + cosf(leader_angle + M_PI) * ORBIT_RADIUS,
-        current_height / 2.0f + sinf(leader_angle + M_PI) * ORBIT_RADIUS * 0.7f,
-        DEPTH / 2.0f + cosf(leader_angle * 1.5f) * 100.0f);
+// Same rules as native: GPU state is never read back, so switching off
+// resumes the CPU flock, and a count or size change restarts the GPU one.
+// Call with the sim locked.
+void sync_backend() {
+  bool want_gpu = config.gpu_backend && !gpu_unavailable;
+  if (gpu && (!want_gpu ||
+              gpu_flock_count(gpu) != flock_world_particles(world)->count)) {
+    gpu_flock_destroy(gpu);
+    gpu = NULL;
+    if (!want_gpu)
+      printf("Backend: CPU\n");
+  }
+  if (want_gpu && !gpu) {
+    gpu = gpu_flock_create(world);
+    gpu_unavailable = gpu == NULL;
+    gpu_due = sim_thread_now();
+    printf("Backend: %s\n", gpu ? "GPU (WebGL2)" : "CPU (no WebGL2)");
   }
+  sim_thread_set_paused(sim, gpu != NULL);
+}
 
-  leader1.x += (target_leader1.x - leader1.x) * LEADER_INTERPOLATION;
-  leader1.y += (target_leader1.y - leader1.y) * LEADER_INTERPOLATION;
-  leader1.z += (target_leader1.z - leader1.z) * LEADER_INTERPOLATION;
-  leader2.x += (target_leader2.x - leader2.x) * LEADER_INTERPOLATION;
-  leader2.y += (target_leader2.y - leader2.y) * LEADER_INTERPOLATION;
-  leader2.z += (target_leader2.z - leader2.z) * LEADER_INTERPOLATION;
-
-  spatial_grid_update(spatial_grid, particles, NUM_PARTICLES);
-
-  for (int i = 0; i < NUM_PARTICLES; i++) {
-    int *neighbors;
-    int neighbor_count;
-    spatial_grid_query_neighbors(spatial_grid, particles,
-                                 &particles[i].position, PERCEPTION_RADIUS,
-                                 &neighbors, &neighbor_count);
-
-    particle_flock_optimized(&particles[i], i, particles, neighbors,
-                             neighbor_count, &leader1, &leader2,
-                             PERCEPTION_RADIUS, separation_weight);
-    particle_update(&particles[i]);
-    particle_wrap(&particles[i], current_width, current_height, DEPTH);
+// The GPU backend needs the GL context, so its fixed steps run here. The
+// cursor reaches the sim through its mailbox; the lock is taken only while
+// the backend changes or the GPU steps.
+void update_simulation() {
+  const Vector3D *target = app_state.follow_cursor ? &app_state.mouse_pos : NULL;
+  sim_thread_set_target(sim, target);
+  if (backend_stale || gpu) {
+    sim_thread_lock(sim);
+    if (backend_stale)
+      sync_backend();
+    backend_stale = false;
+    if (gpu) {
+      flock_world_set_target(world, target);
+      double now = sim_thread_now();
+      if (now - gpu_due > 4.0 / SIM_RATE_HZ)
+        gpu_due = now;
+      while (gpu_due <= now) {
+        FlockWorldControls controls;
+        flock_world_advance_controls(world, &controls);
+        gpu_flock_step(gpu, &controls, &config, current_width, current_height,
+                       DEPTH);
+        gpu_due += 1.0 / SIM_RATE_HZ;
+      }
+    }
+    sim_thread_unlock(sim);
   }
+  sim_thread_pump(sim);
+}
+
+static inline uint16_t pack_unorm16(float v, float scale) {
+  float t = v * scale;
+  if (t < 0.0f)
+    t = 0.0f;
+  if (t > 1.0f)
+    t = 1.0f;
+  return (uint16_t)(t * 65535.0f + 0.5f);
+}
 
-  frame_counter++;
-  if (frame_counter >= SORT_EVERY_N_FRAMES) {
-    qsort(particles, NUM_PARTICLES, sizeof(Particle), compare_particles_by_z);
-    frame_counter = 0;
+// Views go stale when an array is reallocated, when the count changes, and
+// when memory growth replaces the heap buffer under all of them.
+void update_state_export(const SimView *view) {
+  StateExport next = {.generation = state_export.generation, .stride = 1};
+  if (view && view->particles) {
+    next.count = view->particles->count;
+    next.x = view->particles->x;
+    next.y = view->particles->y;
+    next.z = view->particles->z;
+    next.vx = view->vx;
+    next.vy = view->vy;
+    next.vz = view->vz;
   }
+  size_t heap_size = emscripten_get_heap_size();
+  const StateExport *prev = &state_export;
+  if (heap_size != state_heap_size || next.count != prev->count ||
+      next.x != prev->x || next.y != prev->y || next.z != prev->z ||
+      next.vx != prev->vx || next.vy != prev->vy || next.vz != prev->vz)
+    next.generation++;
+  state_heap_size = heap_size;
+  state_export = next;
 }
 
 void render() {
   glClear(GL_COLOR_BUFFER_BIT);
   glUseProgram(program);
 
-  // Update viewport resolution uniform
-  glUniform2f(resolution_uniform, (float)current_width, (float)current_height);
-
-  float vertex_data[NUM_PARTICLES * 6];
-
-  for (int i = 0; i < NUM_PARTICLES; i++) {
-    Particle *p = &particles[i];
-    float depth_factor = p->position.z / DEPTH;
-    float size = 1.5f + ((DEPTH - p->position.z) / DEPTH) * 3.0f;
-
-    // Black to grey gradient based on depth (closer = darker, farther = lighter grey)
-    float gray = depth_factor * 0.5f;  // 0.0 (black) to 0.5 (grey)
-
-    vertex_data[i * 6 + 0] = p->position.x;
-    vertex_data[i * 6 + 1] = p->position.y;
-    vertex_data[i * 6 + 2] = gray;
-    vertex_data[i * 6 + 3] = gray;
-    vertex_data[i * 6 + 4] = gray;
-    vertex_data[i * 6 + 5] = size;
+  if (gpu) {
+    glBindBuffer(GL_ARRAY_BUFFER, gpu_flock_position_buffer(gpu));
+    glVertexAttribPointer(position_attrib, 3, GL_FLOAT, GL_FALSE,
+                          4 * sizeof(float), (void *)0);
+    glUniform3f(scale_uniform, 1.0f / (float)current_width,
+                1.0f / (float)current_height, 1.0f / DEPTH);
+    glDrawArrays(GL_POINTS, 0, gpu_flock_count(gpu));
+    update_state_export(NULL);
+    return;
   }
 
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_data), vertex_data,
-               GL_DYNAMIC_DRAW);
-
-  glVertexAttribPointer(position_attrib, 2, GL_FLOAT, GL_FALSE,
-                        6 * sizeof(float), (void *)0);
-  glEnableVertexAttribArray(position_attrib);
+  glVertexAttribPointer(position_attrib, 3, GL_UNSIGNED_SHORT, GL_TRUE,
+                        sizeof(PackedVertex), (void *)0);
+  glUniform3f(scale_uniform, 1.0f, 1.0f, 1.0f);
+
+  const SimView *view = sim_thread_view(sim);
+  update_state_export(view);
+  const ParticleSoA *particles = view->particles;
+  int count = particles->count;
+  if (count > vertex_capacity) {
+    PackedVertex *vertices =
+        realloc(vertex_data, sizeof(PackedVertex) * particles->capacity);
+    if (!vertices)
+      return;
+    vertex_data = vertices;
+    vertex_capacity = particles->capacity;
+  }
 
-  glVertexAttribPointer(color_attrib, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-                        (void *)(2 * sizeof(float)));
-  glEnableVertexAttribArray(color_attrib);
+  float sx = 1.0f / (float)current_width;
+  float sy = 1.0f / (float)current_height;
+  float sz = 1.0f / DEPTH;
+  // Packing walks the depth order, so back-to-front costs nothing extra.
+  const int *order = view->order;
+  for (int i = 0; i < count; i++) {
+    int h = order ? order[i] : i;
+    vertex_data[i].x = pack_unorm16(particles->x[h], sx);
+    vertex_data[i].y = pack_unorm16(particles->y[h], sy);
+    vertex_data[i].z = pack_unorm16(particles->z[h], sz);
+  }
 
-  glVertexAttribPointer(size_attrib, 1, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-                        (void *)(5 * sizeof(float)));
-  glEnableVertexAttribArray(size_attrib);
+  // Orphan at full capacity, then fill only what is drawn: the driver can
+  // hand back fresh storage instead of waiting on last frame's draw.
+  glBufferData(GL_ARRAY_BUFFER, sizeof(PackedVertex) * vertex_capacity, NULL,
+               GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(PackedVertex) * count,
+                  vertex_data);
 
-  glDrawArrays(GL_POINTS, 0, NUM_PARTICLES);
+  glDrawArrays(GL_POINTS, 0, count);
 }
 
 void main_loop() {
+  trace_begin("update");
   update_simulation();
+  trace_end();
+  trace_begin("render");
   render();
+  trace_end();
 }
 
 // Exported function to handle canvas resize from JavaScript
@@ -285,6 +383,63 @@ void resize_canvas(int width, int height) {
   current_width = width;
   current_height = height;
   glViewport(0, 0, width, height);
+
+  if (world) {
+    sim_thread_lock(sim);
+    flock_world_resize(world, width, height, DEPTH);
+    sim_thread_unlock(sim);
+  }
+  // The GPU flock restarts from the rescaled CPU one next frame.
+  gpu_flock_destroy(gpu);
+  gpu = NULL;
+  backend_stale = true;
+}
+
+// Zero-copy particle state for JS; see StateExport.
+EMSCRIPTEN_KEEPALIVE
+const StateExport *flock_state() { return &state_export; }
+
+// Replaces the flock with a snapshot JS has copied into the heap (see
+// ?snapshot= in index.html); the caller frees data afterwards. Returns 0, or
+// -1 if data isn't a snapshot. Like a resize, the GPU flock restarts from it.
+EMSCRIPTEN_KEEPALIVE
+int load_snapshot(const void *data, int size) {
+  if (!world || size < 0)
+    return -1;
+  sim_thread_lock(sim);
+  int status = flock_world_load_snapshot(world, data, (size_t)size);
+  config = *flock_world_config(world);
+  sim_thread_unlock(sim);
+  if (status == 0) {
+    gpu_flock_destroy(gpu);
+    gpu = NULL;
+    backend_stale = true;
+  }
+  printf(status == 0 ? "Loaded snapshot: %d particles\n" : "Not a flock snapshot\n",
+         config.num_particles);
+  return status;
+}
+
+// Exported config setters; values take effect from the next frame. Both
+// return 0 on success and -1 if any key or value was rejected.
+EMSCRIPTEN_KEEPALIVE
+int set_config(const char *key, const char *value) {
+  ensure_config();
+  FlockConfig next = config;
+  if (flock_config_set(&next, key, value) != 0)
+    return -1;
+  return apply_config(&next);
+}
+
+// Same "key = value" text a native config file holds.
+EMSCRIPTEN_KEEPALIVE
+int load_config(const char *text) {
+  ensure_config();
+  FlockConfig next = config;
+  int status = flock_config_parse_string(&next, text);
+  if (apply_config(&next) != 0)
+    status = -1;
+  return status;
 }
 
 int main() {
@@ -294,8 +449,15 @@ int main() {
   attrs.depth = false;
   attrs.antialias = true;
 
+  // WebGL2 for the GPU backend; the point renderer itself only needs 1.
+  attrs.majorVersion = 2;
   EMSCRIPTEN_WEBGL_CONTEXT_HANDLE ctx =
       emscripten_webgl_create_context("#canvas", &attrs);
+  if (ctx <= 0) {
+    attrs.majorVersion = 1;
+    gpu_unavailable = true;
+    ctx = emscripten_webgl_create_context("#canvas", &attrs);
+  }
   emscripten_webgl_make_context_current(ctx);
 
   // Get actual canvas dimensions
@@ -307,6 +469,7 @@ int main() {
   // Set initial viewport
   glViewport(0, 0, current_width, current_height);
 
+  ensure_config();
   init_gl();
   init_simulation();
 
@@ -8,8 +8,6 @@ Particle particle_create(float x, float y, float z) {
     p.velocity = vec3_random3d();
     vec3_mult(&p.velocity, 2.0f);
     p.acceleration = vec3_create(0, 0, 0);
-    p.max_speed = 4.0f;
-    p.max_force = 0.1f;
     return p;
 }
 
@@ -31,9 +29,9 @@ Vector3D particle_separate(Particle* p, Particle* particles, int count, float pe
 
     if (total > 0) {
         vec3_div(&steering, (float)total);
-        vec3_set_mag(&steering, p->max_speed);
+        vec3_set_mag(&steering, PARTICLE_MAX_SPEED);
         vec3_sub(&steering, &p->velocity);
-        vec3_limit(&steering, p->max_force);
+        vec3_limit(&steering, PARTICLE_MAX_FORCE);
     }
 
     return steering;
@@ -55,9 +53,9 @@ Vector3D particle_align(Particle* p, Particle* particles, int count, float perce
 
     if (total > 0) {
         vec3_div(&steering, (float)total);
-        vec3_set_mag(&steering, p->max_speed);
+        vec3_set_mag(&steering, PARTICLE_MAX_SPEED);
         vec3_sub(&steering, &p->velocity);
-        vec3_limit(&steering, p->max_force);
+        vec3_limit(&steering, PARTICLE_MAX_FORCE);
     }
 
     return steering;
@@ -80,9 +78,9 @@ Vector3D particle_cohesion(Particle* p, Particle* particles, int count, float pe
     if (total > 0) {
         vec3_div(&steering, (float)total);
         vec3_sub(&steering, &p->position);
-        vec3_set_mag(&steering, p->max_speed);
+        vec3_set_mag(&steering, PARTICLE_MAX_SPEED);
         vec3_sub(&steering, &p->velocity);
-        vec3_limit(&steering, p->max_force);
+        vec3_limit(&steering, PARTICLE_MAX_FORCE);
     }
 
     return steering;
@@ -90,10 +88,7 @@ Vector3D particle_cohesion(Particle* p, Particle* particles, int count, float pe
 
 Vector3D particle_seek(Particle* p, const Vector3D* target) {
     Vector3D desired = vec3_sub_new(target, &p->position);
-    vec3_set_mag(&desired, p->max_speed);
-    Vector3D steer = vec3_sub_new(&desired, &p->velocity);
-    vec3_limit(&steer, p->max_force);
-    return steer;
+    return vec3_steer(desired, PARTICLE_MAX_SPEED, &p->velocity, PARTICLE_MAX_FORCE);
 }
 
 void particle_flock(Particle* p, Particle* particles, int count,
@@ -120,16 +115,24 @@ void particle_flock(Particle* p, Particle* particles, int count,
 }
 
 void particle_update(Particle* p) {
-    vec3_add(&p->velocity, &p->acceleration);
-    vec3_limit(&p->velocity, p->max_speed);
-    vec3_add(&p->position, &p->velocity);
-    vec3_mult(&p->acceleration, 0.0f);
+    p->velocity = vec3_clamp(vec3_plus(p->velocity, p->acceleration), PARTICLE_MAX_SPEED);
+    p->position = vec3_plus(p->position, p->velocity);
+    p->acceleration = vec3_create(0, 0, 0);
 }
 
-void particle_flock_optimized(Particle* p, int particle_idx, Particle* particles,
-                              int* neighbors, int neighbor_count,
-                              const Vector3D* leader1, const Vector3D* leader2,
-                              float perception_radius, float separation_weight) {
+static inline float min_image(float d, float extent) {
+    if (d > extent * 0.5f) return d - extent;
+    if (d < -extent * 0.5f) return d + extent;
+    return d;
+}
+
+// world_size == NULL: plain Euclidean offsets. Otherwise each neighbor is
+// replaced by its image nearest p in a periodic world of that size.
+static void flock_neighbors(Particle* p, int particle_idx, Particle* particles,
+                            int* neighbors, int neighbor_count,
+                            const Vector3D* leader1, const Vector3D* leader2,
+                            float perception_radius, float separation_weight,
+                            const Vector3D* world_size) {
     Vector3D separation = vec3_create(0, 0, 0);
     Vector3D alignment = vec3_create(0, 0, 0);
     Vector3D cohesion = vec3_create(0, 0, 0);
@@ -142,55 +145,68 @@ void particle_flock_optimized(Particle* p, int particle_idx, Particle* particles
         if (neighbor_idx == particle_idx) continue;
 
         Particle* other = &particles[neighbor_idx];
-        float dist_sq = vec3_dist_sq_inline(&p->position, &other->position);
+        Vector3D other_pos = other->position;
+        if (world_size) {
+            Vector3D d = vec3_minus(p->position, other_pos);
+            other_pos = vec3_create(p->position.x - min_image(d.x, world_size->x),
+                                    p->position.y - min_image(d.y, world_size->y),
+                                    p->position.z - min_image(d.z, world_size->z));
+        }
+        Vector3D diff = vec3_minus(p->position, other_pos);
+        float dist_sq = vec3_length_sq(diff);
 
         if (dist_sq < perception_radius_sq && dist_sq > 0.001f) {
-            Vector3D diff = vec3_sub_new(&p->position, &other->position);
-            vec3_div(&diff, dist_sq);
-            vec3_add(&separation, &diff);
+            separation = vec3_plus(separation, vec3_scaled(diff, 1.0f / dist_sq));
             sep_count++;
 
-            vec3_add(&alignment, &other->velocity);
+            alignment = vec3_plus(alignment, other->velocity);
             align_count++;
 
-            vec3_add(&cohesion, &other->position);
+            cohesion = vec3_plus(cohesion, other_pos);
             coh_count++;
         }
     }
 
     if (sep_count > 0) {
-        vec3_div(&separation, (float)sep_count);
-        vec3_set_mag(&separation, p->max_speed);
-        vec3_sub(&separation, &p->velocity);
-        vec3_limit(&separation, p->max_force);
-        vec3_mult(&separation, separation_weight);
+        separation = vec3_scaled(vec3_steer(separation, PARTICLE_MAX_SPEED, &p->velocity,
+                                            PARTICLE_MAX_FORCE),
+                                 separation_weight);
     }
 
     if (align_count > 0) {
-        vec3_div(&alignment, (float)align_count);
-        vec3_set_mag(&alignment, p->max_speed);
-        vec3_sub(&alignment, &p->velocity);
-        vec3_limit(&alignment, p->max_force);
+        alignment = vec3_steer(alignment, PARTICLE_MAX_SPEED, &p->velocity, PARTICLE_MAX_FORCE);
     }
 
     if (coh_count > 0) {
-        vec3_div(&cohesion, (float)coh_count);
-        vec3_sub(&cohesion, &p->position);
-        vec3_set_mag(&cohesion, p->max_speed);
-        vec3_sub(&cohesion, &p->velocity);
-        vec3_limit(&cohesion, p->max_force);
+        Vector3D to_center = vec3_minus(vec3_scaled(cohesion, 1.0f / (float)coh_count), p->position);
+        cohesion = vec3_steer(to_center, PARTICLE_MAX_SPEED, &p->velocity, PARTICLE_MAX_FORCE);
     }
 
     float dist1_sq = vec3_dist_sq_inline(&p->position, leader1);
     float dist2_sq = vec3_dist_sq_inline(&p->position, leader2);
     const Vector3D* closest_leader = (dist1_sq < dist2_sq) ? leader1 : leader2;
-    Vector3D leader_attraction = particle_seek(p, closest_leader);
-    vec3_mult(&leader_attraction, 0.5f);
+    Vector3D leader_attraction = vec3_scaled(particle_seek(p, closest_leader), 0.5f);
 
-    vec3_add(&p->acceleration, &separation);
-    vec3_add(&p->acceleration, &alignment);
-    vec3_add(&p->acceleration, &cohesion);
-    vec3_add(&p->acceleration, &leader_attraction);
+    Vector3D steering = vec3_plus(vec3_plus(separation, alignment),
+                                  vec3_plus(cohesion, leader_attraction));
+    p->acceleration = vec3_plus(p->acceleration, steering);
+}
+
+void particle_flock_optimized(Particle* p, int particle_idx, Particle* particles,
+                              int* neighbors, int neighbor_count,
+                              const Vector3D* leader1, const Vector3D* leader2,
+                              float perception_radius, float separation_weight) {
+    flock_neighbors(p, particle_idx, particles, neighbors, neighbor_count,
+                    leader1, leader2, perception_radius, separation_weight, NULL);
+}
+
+void particle_flock_optimized_periodic(Particle* p, int particle_idx, Particle* particles,
+                                       int* neighbors, int neighbor_count,
+                                       const Vector3D* leader1, const Vector3D* leader2,
+                                       float perception_radius, float separation_weight,
+                                       const Vector3D* world_size) {
+    flock_neighbors(p, particle_idx, particles, neighbors, neighbor_count,
+                    leader1, leader2, perception_radius, separation_weight, world_size);
 }
 
 void particle_wrap(Particle* p, float width, float height, float depth) {
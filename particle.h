@@ -3,12 +3,15 @@
 
 #include "vector3d.h"
 
+// Limits of the AoS reference path, the same as the default flock group
+// (flock_group.h); they are constants, not per-particle fields.
+#define PARTICLE_MAX_SPEED 4.0f
+#define PARTICLE_MAX_FORCE 0.1f
+
 typedef struct {
     Vector3D position;
     Vector3D velocity;
     Vector3D acceleration;
-    float max_speed;
-    float max_force;
 } Particle;
 
 Particle particle_create(float x, float y, float z);
@@ -23,6 +26,13 @@ void particle_flock_optimized(Particle* p, int particle_idx, Particle* particles
                               int* neighbors, int neighbor_count,
                               const Vector3D* leader1, const Vector3D* leader2,
                               float perception_radius, float separation_weight);
+// Minimum-image variant for a toroidal world of world_size, as wrapped by
+// particle_wrap.
+void particle_flock_optimized_periodic(Particle* p, int particle_idx, Particle* particles,
+                                       int* neighbors, int neighbor_count,
+                                       const Vector3D* leader1, const Vector3D* leader2,
+                                       float perception_radius, float separation_weight,
+                                       const Vector3D* world_size);
 void particle_update(Particle* p);
 void particle_wrap(Particle* p, float width, float height, float depth);
 
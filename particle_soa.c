@@ -0,0 +1,800 @@
+#include "particle_soa.h"
+#include "rng.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_WIDTH 8
+#define SIMD_NAME "avx2"
+typedef __m256 simd_f;
+
+static inline simd_f simd_set1(float v) { return _mm256_set1_ps(v); }
+static inline simd_f simd_load(const float* p) { return _mm256_loadu_ps(p); }
+static inline void simd_store(float* p, simd_f v) { _mm256_storeu_ps(p, v); }
+static inline simd_f simd_add(simd_f a, simd_f b) { return _mm256_add_ps(a, b); }
+static inline simd_f simd_sub(simd_f a, simd_f b) { return _mm256_sub_ps(a, b); }
+static inline simd_f simd_mul(simd_f a, simd_f b) { return _mm256_mul_ps(a, b); }
+static inline simd_f simd_div(simd_f a, simd_f b) { return _mm256_div_ps(a, b); }
+static inline simd_f simd_sqrt(simd_f a) { return _mm256_sqrt_ps(a); }
+static inline simd_f simd_lt(simd_f a, simd_f b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline simd_f simd_gt(simd_f a, simd_f b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline simd_f simd_and(simd_f a, simd_f b) { return _mm256_and_ps(a, b); }
+static inline simd_f simd_select(simd_f mask, simd_f a, simd_f b) { return _mm256_blendv_ps(b, a, mask); }
+static inline simd_f simd_gather(const float* base, const int* idx) {
+    return _mm256_i32gather_ps(base, _mm256_loadu_si256((const __m256i*)idx), 4);
+}
+static inline float simd_hsum(simd_f v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_hadd_ps(s, s);
+    s = _mm_hadd_ps(s, s);
+    return _mm_cvtss_f32(s);
+}
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_WIDTH 4
+#define SIMD_NAME "sse2"
+typedef __m128 simd_f;
+
+static inline simd_f simd_set1(float v) { return _mm_set1_ps(v); }
+static inline simd_f simd_load(const float* p) { return _mm_loadu_ps(p); }
+static inline void simd_store(float* p, simd_f v) { _mm_storeu_ps(p, v); }
+static inline simd_f simd_add(simd_f a, simd_f b) { return _mm_add_ps(a, b); }
+static inline simd_f simd_sub(simd_f a, simd_f b) { return _mm_sub_ps(a, b); }
+static inline simd_f simd_mul(simd_f a, simd_f b) { return _mm_mul_ps(a, b); }
+static inline simd_f simd_div(simd_f a, simd_f b) { return _mm_div_ps(a, b); }
+static inline simd_f simd_sqrt(simd_f a) { return _mm_sqrt_ps(a); }
+static inline simd_f simd_lt(simd_f a, simd_f b) { return _mm_cmplt_ps(a, b); }
+static inline simd_f simd_gt(simd_f a, simd_f b) { return _mm_cmpgt_ps(a, b); }
+static inline simd_f simd_and(simd_f a, simd_f b) { return _mm_and_ps(a, b); }
+static inline simd_f simd_select(simd_f mask, simd_f a, simd_f b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+static inline simd_f simd_gather(const float* base, const int* idx) {
+    return _mm_set_ps(base[idx[3]], base[idx[2]], base[idx[1]], base[idx[0]]);
+}
+static inline float simd_hsum(simd_f v) {
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define SIMD_WIDTH 4
+#define SIMD_NAME "wasm128"
+typedef v128_t simd_f;
+
+static inline simd_f simd_set1(float v) { return wasm_f32x4_splat(v); }
+static inline simd_f simd_load(const float* p) { return wasm_v128_load(p); }
+static inline void simd_store(float* p, simd_f v) { wasm_v128_store(p, v); }
+static inline simd_f simd_add(simd_f a, simd_f b) { return wasm_f32x4_add(a, b); }
+static inline simd_f simd_sub(simd_f a, simd_f b) { return wasm_f32x4_sub(a, b); }
+static inline simd_f simd_mul(simd_f a, simd_f b) { return wasm_f32x4_mul(a, b); }
+static inline simd_f simd_div(simd_f a, simd_f b) { return wasm_f32x4_div(a, b); }
+static inline simd_f simd_sqrt(simd_f a) { return wasm_f32x4_sqrt(a); }
+static inline simd_f simd_lt(simd_f a, simd_f b) { return wasm_f32x4_lt(a, b); }
+static inline simd_f simd_gt(simd_f a, simd_f b) { return wasm_f32x4_gt(a, b); }
+static inline simd_f simd_and(simd_f a, simd_f b) { return wasm_v128_and(a, b); }
+static inline simd_f simd_select(simd_f mask, simd_f a, simd_f b) { return wasm_v128_bitselect(a, b, mask); }
+static inline simd_f simd_gather(const float* base, const int* idx) {
+    return wasm_f32x4_make(base[idx[0]], base[idx[1]], base[idx[2]], base[idx[3]]);
+}
+static inline float simd_hsum(simd_f v) {
+    return wasm_f32x4_extract_lane(v, 0) + wasm_f32x4_extract_lane(v, 1) +
+           wasm_f32x4_extract_lane(v, 2) + wasm_f32x4_extract_lane(v, 3);
+}
+
+#else
+#define SIMD_WIDTH 1
+#define SIMD_NAME "scalar"
+#endif
+
+static float* soa_alloc_array(int capacity, size_t elem_size) {
+    size_t bytes = elem_size * (size_t)(capacity > 0 ? capacity : 1);
+    bytes = (bytes + PARTICLE_SOA_ALIGNMENT - 1) & ~(size_t)(PARTICLE_SOA_ALIGNMENT - 1);
+    return aligned_alloc(PARTICLE_SOA_ALIGNMENT, bytes);
+}
+
+ParticleSoA* particle_soa_create(int capacity) {
+    ParticleSoA* s = malloc(sizeof(ParticleSoA));
+
+    s->count = 0;
+    s->capacity = capacity;
+    s->groups[0] = flock_group_default();
+    s->group_count = 1;
+    s->periodic = 0;
+    s->period_x = 0.0f;
+    s->period_y = 0.0f;
+    s->period_z = 0.0f;
+
+    float** arrays[] = {&s->x, &s->y, &s->z, &s->vx, &s->vy, &s->vz,
+                        &s->ax, &s->ay, &s->az, &s->scratch};
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+        *arrays[i] = soa_alloc_array(capacity, sizeof(float));
+    }
+    s->order = malloc(sizeof(int) * (capacity > 0 ? capacity : 1));
+    s->remap = malloc(sizeof(int) * (capacity > 0 ? capacity : 1));
+    s->handle_of_slot = malloc(sizeof(int) * (capacity > 0 ? capacity : 1));
+    s->slot_of_handle = malloc(sizeof(int) * (capacity > 0 ? capacity : 1));
+    s->group = malloc(capacity > 0 ? capacity : 1);
+
+    return s;
+}
+
+void particle_soa_destroy(ParticleSoA* s) {
+    free(s->x);
+    free(s->y);
+    free(s->z);
+    free(s->vx);
+    free(s->vy);
+    free(s->vz);
+    free(s->ax);
+    free(s->ay);
+    free(s->az);
+    free(s->scratch);
+    free(s->order);
+    free(s->remap);
+    free(s->handle_of_slot);
+    free(s->slot_of_handle);
+    free(s->group);
+    free(s);
+}
+
+static int grow_float_array(float** array, int count, int capacity) {
+    float* grown = soa_alloc_array(capacity, sizeof(float));
+    if (!grown) return -1;
+    memcpy(grown, *array, sizeof(float) * count);
+    free(*array);
+    *array = grown;
+    return 0;
+}
+
+static int grow_array(void** array, size_t elem_size, int capacity) {
+    void* grown = realloc(*array, elem_size * capacity);
+    if (!grown) return -1;
+    *array = grown;
+    return 0;
+}
+
+int particle_soa_reserve(ParticleSoA* s, int capacity) {
+    if (capacity <= s->capacity) return 0;
+
+    float** arrays[] = {&s->x, &s->y, &s->z, &s->vx, &s->vy, &s->vz,
+                        &s->ax, &s->ay, &s->az, &s->scratch};
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+        if (grow_float_array(arrays[i], s->count, capacity) != 0) return -1;
+    }
+    if (grow_array((void**)&s->order, sizeof(int), capacity) != 0 ||
+        grow_array((void**)&s->remap, sizeof(int), capacity) != 0 ||
+        grow_array((void**)&s->handle_of_slot, sizeof(int), capacity) != 0 ||
+        grow_array((void**)&s->slot_of_handle, sizeof(int), capacity) != 0 ||
+        grow_array((void**)&s->group, sizeof(uint8_t), capacity) != 0) {
+        return -1;
+    }
+
+    s->capacity = capacity;
+    return 0;
+}
+
+void particle_soa_truncate(ParticleSoA* s, int count) {
+    if (count < 0) count = 0;
+    if (count >= s->count) return;
+
+    // Handles are dense in [0, count), so keeping the ones below the new
+    // count drops the newest particles and leaves every survivor's handle
+    // valid. The survivors keep their relative order.
+    int kept = 0;
+    for (int i = 0; i < s->count; i++) {
+        s->remap[i] = -1;
+        if (s->handle_of_slot[i] < count) s->order[kept++] = i;
+    }
+    s->count = kept;
+    particle_soa_permute(s, s->order);
+}
+
+int particle_soa_spawn(ParticleSoA* s, float x, float y, float z) {
+    if (s->count >= s->capacity) return -1;
+
+    int i = s->count++;
+    Vector3D v = vec3_random3d();
+    vec3_mult(&v, 2.0f);
+
+    s->x[i] = x;
+    s->y[i] = y;
+    s->z[i] = z;
+    s->vx[i] = v.x;
+    s->vy[i] = v.y;
+    s->vz[i] = v.z;
+    s->ax[i] = 0.0f;
+    s->ay[i] = 0.0f;
+    s->az[i] = 0.0f;
+    s->handle_of_slot[i] = i;
+    s->slot_of_handle[i] = i;
+    s->group[i] = (uint8_t)(i % s->group_count);
+    return i;
+}
+
+int particle_soa_claim(ParticleSoA* s, int count) {
+    int first = s->count;
+    if (count > s->capacity - first) count = s->capacity - first;
+    for (int i = first; i < first + count; i++) {
+        s->handle_of_slot[i] = i;
+        s->slot_of_handle[i] = i;
+        s->group[i] = (uint8_t)(i % s->group_count);
+    }
+    s->count = first + count;
+    return first;
+}
+
+void particle_soa_fill_random(ParticleSoA* s, int begin, int end, uint64_t seed,
+                              float width, float height, float depth) {
+    for (int i = begin; i < end; i++) {
+        Rng rng = rng_stream(seed, (uint64_t)i);
+        Vector3D v = rng_unit_vector(&rng);
+
+        s->x[i] = rng_float(&rng) * width;
+        s->y[i] = rng_float(&rng) * height;
+        s->z[i] = rng_float(&rng) * depth;
+        s->vx[i] = v.x * 2.0f;
+        s->vy[i] = v.y * 2.0f;
+        s->vz[i] = v.z * 2.0f;
+        s->ax[i] = 0.0f;
+        s->ay[i] = 0.0f;
+        s->az[i] = 0.0f;
+    }
+}
+
+int particle_soa_spawn_bulk(ParticleSoA* s, int count, uint64_t seed,
+                            float width, float height, float depth) {
+    int first = particle_soa_claim(s, count);
+    particle_soa_fill_random(s, first, s->count, seed, width, height, depth);
+    return s->count - first;
+}
+
+void particle_soa_from_aos(ParticleSoA* s, const Particle* particles, int count) {
+    if (count > s->capacity) count = s->capacity;
+
+    for (int i = 0; i < count; i++) {
+        const Particle* p = &particles[i];
+        s->x[i] = p->position.x;
+        s->y[i] = p->position.y;
+        s->z[i] = p->position.z;
+        s->vx[i] = p->velocity.x;
+        s->vy[i] = p->velocity.y;
+        s->vz[i] = p->velocity.z;
+        s->ax[i] = p->acceleration.x;
+        s->ay[i] = p->acceleration.y;
+        s->az[i] = p->acceleration.z;
+        s->handle_of_slot[i] = i;
+        s->slot_of_handle[i] = i;
+        s->group[i] = (uint8_t)(i % s->group_count);
+    }
+    s->count = count;
+}
+
+void particle_soa_to_aos(const ParticleSoA* s, Particle* particles) {
+    for (int i = 0; i < s->count; i++) {
+        Particle* p = &particles[i];
+        p->position = vec3_create(s->x[i], s->y[i], s->z[i]);
+        p->velocity = vec3_create(s->vx[i], s->vy[i], s->vz[i]);
+        p->acceleration = vec3_create(s->ax[i], s->ay[i], s->az[i]);
+    }
+}
+
+static inline float min_image(float d, float extent) {
+    if (d > extent * 0.5f) return d - extent;
+    if (d < -extent * 0.5f) return d + extent;
+    return d;
+}
+
+#if SIMD_WIDTH > 1
+static inline simd_f simd_min_image(simd_f d, simd_f extent) {
+    simd_f half = simd_mul(extent, simd_set1(0.5f));
+    d = simd_select(simd_gt(d, half), simd_sub(d, extent), d);
+    return simd_select(simd_lt(d, simd_sub(simd_set1(0.0f), half)), simd_add(d, extent), d);
+}
+#endif
+
+void particle_soa_set_periodic(ParticleSoA* s, int periodic,
+                               float width, float height, float depth) {
+    s->periodic = periodic;
+    s->period_x = width;
+    s->period_y = height;
+    s->period_z = depth;
+}
+
+void particle_soa_set_groups(ParticleSoA* s, const FlockGroup* groups, int count) {
+    if (count < 1) count = 1;
+    if (count > MAX_FLOCK_GROUPS) count = MAX_FLOCK_GROUPS;
+    memcpy(s->groups, groups, sizeof(FlockGroup) * count);
+    if (count == s->group_count) return;
+    s->group_count = count;
+    for (int i = 0; i < s->count; i++) {
+        s->group[i] = (uint8_t)(s->handle_of_slot[i] % count);
+    }
+}
+
+float particle_soa_max_speed(const ParticleSoA* s) {
+    float fastest = s->groups[0].max_speed;
+    for (int g = 1; g < s->group_count; g++) {
+        if (s->groups[g].max_speed > fastest) fastest = s->groups[g].max_speed;
+    }
+    return fastest;
+}
+
+static Vector3D soa_seek(const ParticleSoA* s, int i, const FlockGroup* g,
+                         const Vector3D* target) {
+    Vector3D desired = vec3_create(target->x - s->x[i], target->y - s->y[i], target->z - s->z[i]);
+    Vector3D velocity = vec3_create(s->vx[i], s->vy[i], s->vz[i]);
+    return vec3_steer(desired, g->max_speed, &velocity, g->max_force);
+}
+
+// The group's own radius where it sets a smaller one than the query's.
+static inline float group_radius(const FlockGroup* g, float perception_radius) {
+    return g->perception_radius > 0.0f && g->perception_radius < perception_radius
+               ? g->perception_radius
+               : perception_radius;
+}
+
+// Turns the accumulated neighbor sums into the four steering forces and
+// returns their sum. Shared by the SIMD and scalar kernels. total counts
+// every neighbor in range (separation), kin those of the particle's own
+// group (alignment and cohesion).
+static Vector3D soa_steering(const ParticleSoA* s, int i, const FlockGroup* g,
+                             Vector3D separation, Vector3D alignment, Vector3D cohesion,
+                             int total, int kin, const Vector3D* leader1,
+                             const Vector3D* leader2, float separation_weight) {
+    Vector3D position = vec3_create(s->x[i], s->y[i], s->z[i]);
+    Vector3D velocity = vec3_create(s->vx[i], s->vy[i], s->vz[i]);
+
+    // Separation and alignment are rescaled to max_speed, so only the
+    // cohesion centroid needs the average.
+    if (total > 0) {
+        separation = vec3_steer(separation, g->max_speed, &velocity, g->max_force);
+        vec3_mult(&separation, separation_weight);
+        vec3_mult(&separation, g->separation_weight);
+    }
+    if (kin > 0) {
+        alignment = vec3_steer(alignment, g->max_speed, &velocity, g->max_force);
+        vec3_mult(&alignment, g->alignment_weight);
+
+        float inv_kin = 1.0f / (float)kin;
+        Vector3D to_center = vec3_create(cohesion.x * inv_kin - position.x,
+                                         cohesion.y * inv_kin - position.y,
+                                         cohesion.z * inv_kin - position.z);
+        cohesion = vec3_steer(to_center, g->max_speed, &velocity, g->max_force);
+        vec3_mult(&cohesion, g->cohesion_weight);
+    }
+
+    const Vector3D* leader = leader1;
+    if (g->leader == FLOCK_LEADER_SECOND) {
+        leader = leader2;
+    } else if (g->leader == FLOCK_LEADER_NEAREST) {
+        float dist1_sq = vec3_dist_sq_inline(&position, leader1);
+        float dist2_sq = vec3_dist_sq_inline(&position, leader2);
+        leader = (dist1_sq < dist2_sq) ? leader1 : leader2;
+    }
+    Vector3D leader_attraction = soa_seek(s, i, g, leader);
+    vec3_mult(&leader_attraction, g->leader_weight);
+
+    return vec3_create(separation.x + alignment.x + cohesion.x + leader_attraction.x,
+                       separation.y + alignment.y + cohesion.y + leader_attraction.y,
+                       separation.z + alignment.z + cohesion.z + leader_attraction.z);
+}
+
+static Vector3D soa_flock_accel_scalar(const ParticleSoA* s, int particle_idx,
+                                       const int* neighbors, int neighbor_count,
+                                       const Vector3D* leader1, const Vector3D* leader2,
+                                       float perception_radius, float separation_weight) {
+    Vector3D separation = vec3_create(0, 0, 0);
+    Vector3D alignment = vec3_create(0, 0, 0);
+    Vector3D cohesion = vec3_create(0, 0, 0);
+    int total = 0;
+    int kin = 0;
+
+    int group = s->group[particle_idx];
+    const FlockGroup* g = &s->groups[group];
+    float radius = group_radius(g, perception_radius);
+    float perception_radius_sq = radius * radius;
+    float px = s->x[particle_idx];
+    float py = s->y[particle_idx];
+    float pz = s->z[particle_idx];
+
+    for (int i = 0; i < neighbor_count; i++) {
+        int j = neighbors[i];
+        if (j == particle_idx) continue;
+
+        float ox = s->x[j];
+        float oy = s->y[j];
+        float oz = s->z[j];
+        float dx = px - ox;
+        float dy = py - oy;
+        float dz = pz - oz;
+        if (s->periodic) {
+            // Use the image of the neighbor nearest this particle.
+            dx = min_image(dx, s->period_x);
+            dy = min_image(dy, s->period_y);
+            dz = min_image(dz, s->period_z);
+            ox = px - dx;
+            oy = py - dy;
+            oz = pz - dz;
+        }
+        float dist_sq = dx * dx + dy * dy + dz * dz;
+
+        if (dist_sq < perception_radius_sq && dist_sq > 0.001f) {
+            separation.x += dx / dist_sq;
+            separation.y += dy / dist_sq;
+            separation.z += dz / dist_sq;
+            total++;
+            if (s->group[j] != group) continue;
+
+            alignment.x += s->vx[j];
+            alignment.y += s->vy[j];
+            alignment.z += s->vz[j];
+
+            cohesion.x += ox;
+            cohesion.y += oy;
+            cohesion.z += oz;
+            kin++;
+        }
+    }
+
+    return soa_steering(s, particle_idx, g, separation, alignment, cohesion, total, kin,
+                        leader1, leader2, separation_weight);
+}
+
+Vector3D particle_soa_flock_accel(const ParticleSoA* s, int particle_idx,
+                                  const int* neighbors, int neighbor_count,
+                                  const Vector3D* leader1, const Vector3D* leader2,
+                                  float perception_radius, float separation_weight) {
+#if SIMD_WIDTH > 1
+    // Lanes run across neighbors. Unused tail lanes point at the particle
+    // itself, whose zero distance fails the dist_sq > 0.001 test.
+    int lane_idx[SIMD_WIDTH];
+    float lane_group[SIMD_WIDTH];
+
+    int group = s->group[particle_idx];
+    const FlockGroup* g = &s->groups[group];
+    float radius = group_radius(g, perception_radius);
+    bool mixed = s->group_count > 1;
+
+    simd_f px = simd_set1(s->x[particle_idx]);
+    simd_f py = simd_set1(s->y[particle_idx]);
+    simd_f pz = simd_set1(s->z[particle_idx]);
+    simd_f radius_sq = simd_set1(radius * radius);
+    simd_f min_dist_sq = simd_set1(0.001f);
+    simd_f one = simd_set1(1.0f);
+    simd_f zero = simd_set1(0.0f);
+    simd_f own_group = simd_set1((float)group);
+    simd_f period_x = simd_set1(s->period_x);
+    simd_f period_y = simd_set1(s->period_y);
+    simd_f period_z = simd_set1(s->period_z);
+
+    simd_f sep_x = zero, sep_y = zero, sep_z = zero;
+    simd_f ali_x = zero, ali_y = zero, ali_z = zero;
+    simd_f coh_x = zero, coh_y = zero, coh_z = zero;
+    simd_f total = zero;
+    simd_f kin = zero;
+
+    for (int base = 0; base < neighbor_count; base += SIMD_WIDTH) {
+        for (int l = 0; l < SIMD_WIDTH; l++) {
+            lane_idx[l] = (base + l < neighbor_count) ? neighbors[base + l] : particle_idx;
+        }
+
+        simd_f ox = simd_gather(s->x, lane_idx);
+        simd_f oy = simd_gather(s->y, lane_idx);
+        simd_f oz = simd_gather(s->z, lane_idx);
+
+        simd_f dx = simd_sub(px, ox);
+        simd_f dy = simd_sub(py, oy);
+        simd_f dz = simd_sub(pz, oz);
+        if (s->periodic) {
+            dx = simd_min_image(dx, period_x);
+            dy = simd_min_image(dy, period_y);
+            dz = simd_min_image(dz, period_z);
+            ox = simd_sub(px, dx);
+            oy = simd_sub(py, dy);
+            oz = simd_sub(pz, dz);
+        }
+        simd_f dist_sq = simd_add(simd_add(simd_mul(dx, dx), simd_mul(dy, dy)), simd_mul(dz, dz));
+
+        simd_f mask = simd_and(simd_lt(dist_sq, radius_sq), simd_gt(dist_sq, min_dist_sq));
+        simd_f inv = simd_select(mask, simd_div(one, dist_sq), zero);
+
+        sep_x = simd_add(sep_x, simd_mul(dx, inv));
+        sep_y = simd_add(sep_y, simd_mul(dy, inv));
+        sep_z = simd_add(sep_z, simd_mul(dz, inv));
+        total = simd_add(total, simd_and(mask, one));
+
+        // Ids are bytes, so they are widened lane by lane rather than gathered.
+        simd_f kin_mask = mask;
+        if (mixed) {
+            for (int l = 0; l < SIMD_WIDTH; l++) {
+                lane_group[l] = (float)s->group[lane_idx[l]];
+            }
+            simd_f same = simd_and(simd_gt(simd_load(lane_group), simd_sub(own_group, one)),
+                                   simd_lt(simd_load(lane_group), simd_add(own_group, one)));
+            kin_mask = simd_and(mask, same);
+        }
+
+        ali_x = simd_add(ali_x, simd_and(kin_mask, simd_gather(s->vx, lane_idx)));
+        ali_y = simd_add(ali_y, simd_and(kin_mask, simd_gather(s->vy, lane_idx)));
+        ali_z = simd_add(ali_z, simd_and(kin_mask, simd_gather(s->vz, lane_idx)));
+
+        coh_x = simd_add(coh_x, simd_and(kin_mask, ox));
+        coh_y = simd_add(coh_y, simd_and(kin_mask, oy));
+        coh_z = simd_add(coh_z, simd_and(kin_mask, oz));
+
+        kin = simd_add(kin, simd_and(kin_mask, one));
+    }
+
+    Vector3D separation = vec3_create(simd_hsum(sep_x), simd_hsum(sep_y), simd_hsum(sep_z));
+    Vector3D alignment = vec3_create(simd_hsum(ali_x), simd_hsum(ali_y), simd_hsum(ali_z));
+    Vector3D cohesion = vec3_create(simd_hsum(coh_x), simd_hsum(coh_y), simd_hsum(coh_z));
+
+    return soa_steering(s, particle_idx, g, separation, alignment, cohesion,
+                        (int)simd_hsum(total), (int)simd_hsum(kin), leader1, leader2,
+                        separation_weight);
+#else
+    return soa_flock_accel_scalar(s, particle_idx, neighbors, neighbor_count,
+                                  leader1, leader2, perception_radius, separation_weight);
+#endif
+}
+
+Vector3D particle_soa_mean_field_accel(const ParticleSoA* s, int particle_idx,
+                                       const int* neighbors, int neighbor_count,
+                                       const Vector3D* offset_sum, const Vector3D* velocity_sum,
+                                       int field_count, const Vector3D* leader1,
+                                       const Vector3D* leader2, float perception_radius,
+                                       float separation_weight) {
+    const FlockGroup* g = &s->groups[s->group[particle_idx]];
+    float radius = group_radius(g, perception_radius);
+    float perception_radius_sq = radius * radius;
+    float px = s->x[particle_idx];
+    float py = s->y[particle_idx];
+    float pz = s->z[particle_idx];
+
+    Vector3D separation = vec3_create(0, 0, 0);
+    int total = 0;
+    for (int n = 0; n < neighbor_count; n++) {
+        int j = neighbors[n];
+        if (j == particle_idx) continue;
+        float dx = px - s->x[j];
+        float dy = py - s->y[j];
+        float dz = pz - s->z[j];
+        if (s->periodic) {
+            dx = min_image(dx, s->period_x);
+            dy = min_image(dy, s->period_y);
+            dz = min_image(dz, s->period_z);
+        }
+        float dist_sq = dx * dx + dy * dy + dz * dz;
+        if (dist_sq < perception_radius_sq && dist_sq > 0.001f) {
+            separation.x += dx / dist_sq;
+            separation.y += dy / dist_sq;
+            separation.z += dz / dist_sq;
+            total++;
+        }
+    }
+
+    // Take this particle back out of the field. soa_steering averages the
+    // cohesion sum and subtracts the position, so offsets go back to
+    // positions here.
+    int kin = field_count > 1 ? field_count - 1 : 0;
+    Vector3D alignment = vec3_create(0, 0, 0);
+    Vector3D cohesion = vec3_create(0, 0, 0);
+    FlockGroup field_group = *g;
+    if (kin > 0) {
+        alignment = vec3_create(velocity_sum->x - s->vx[particle_idx],
+                                velocity_sum->y - s->vy[particle_idx],
+                                velocity_sum->z - s->vz[particle_idx]);
+        cohesion = vec3_create(offset_sum->x + kin * px, offset_sum->y + kin * py,
+                               offset_sum->z + kin * pz);
+
+        // A neighbor list's centroid sits among the nearest few, but a field
+        // centroid spans cells a radius wide and always leans towards the
+        // densest of them. At full strength cohesion then outpulls the
+        // few-neighbor separation and crowds collapse onto points. Fading it
+        // by (centroid distance / radius)^2 inside the radius lets
+        // separation hold the spacing; a linear fade still clumped.
+        float inv_kin = 1.0f / (float)kin;
+        float mx = offset_sum->x * inv_kin;
+        float my = offset_sum->y * inv_kin;
+        float mz = offset_sum->z * inv_kin;
+        float falloff = (mx * mx + my * my + mz * mz) / perception_radius_sq;
+        if (falloff < 1.0f) field_group.cohesion_weight *= falloff;
+    }
+    return soa_steering(s, particle_idx, &field_group, separation, alignment, cohesion, total,
+                        kin, leader1, leader2, separation_weight);
+}
+
+void particle_soa_flock(ParticleSoA* s, int particle_idx,
+                        const int* neighbors, int neighbor_count,
+                        const Vector3D* leader1, const Vector3D* leader2,
+                        float perception_radius, float separation_weight) {
+    Vector3D accel = particle_soa_flock_accel(s, particle_idx, neighbors, neighbor_count,
+                                              leader1, leader2, perception_radius,
+                                              separation_weight);
+    s->ax[particle_idx] += accel.x;
+    s->ay[particle_idx] += accel.y;
+    s->az[particle_idx] += accel.z;
+}
+
+void particle_soa_flock_scalar(ParticleSoA* s, int particle_idx,
+                               const int* neighbors, int neighbor_count,
+                               const Vector3D* leader1, const Vector3D* leader2,
+                               float perception_radius, float separation_weight) {
+    Vector3D accel = soa_flock_accel_scalar(s, particle_idx, neighbors, neighbor_count,
+                                            leader1, leader2, perception_radius,
+                                            separation_weight);
+    s->ax[particle_idx] += accel.x;
+    s->ay[particle_idx] += accel.y;
+    s->az[particle_idx] += accel.z;
+}
+
+void particle_soa_update(ParticleSoA* s, int idx) {
+    Vector3D velocity = vec3_create(s->vx[idx] + s->ax[idx],
+                                    s->vy[idx] + s->ay[idx],
+                                    s->vz[idx] + s->az[idx]);
+    velocity = vec3_clamp(velocity, s->groups[s->group[idx]].max_speed);
+
+    s->vx[idx] = velocity.x;
+    s->vy[idx] = velocity.y;
+    s->vz[idx] = velocity.z;
+    s->x[idx] += velocity.x;
+    s->y[idx] += velocity.y;
+    s->z[idx] += velocity.z;
+    s->ax[idx] = 0.0f;
+    s->ay[idx] = 0.0f;
+    s->az[idx] = 0.0f;
+}
+
+void particle_soa_wrap(ParticleSoA* s, int idx, float width, float height, float depth) {
+    if (s->x[idx] > width) s->x[idx] = 0.0f;
+    if (s->x[idx] < 0.0f) s->x[idx] = width;
+    if (s->y[idx] > height) s->y[idx] = 0.0f;
+    if (s->y[idx] < 0.0f) s->y[idx] = height;
+    if (s->z[idx] > depth) s->z[idx] = 0.0f;
+    if (s->z[idx] < 0.0f) s->z[idx] = depth;
+}
+
+#if SIMD_WIDTH > 1
+static inline simd_f simd_wrap(simd_f p, simd_f zero, simd_f extent) {
+    p = simd_select(simd_gt(p, extent), zero, p);
+    return simd_select(simd_lt(p, zero), extent, p);
+}
+#endif
+
+void particle_soa_integrate_range(ParticleSoA* s, int begin, int end,
+                                  float width, float height, float depth) {
+    int i = begin;
+
+#if SIMD_WIDTH > 1
+    simd_f zero = simd_set1(0.0f);
+    simd_f max_speed = simd_set1(s->groups[0].max_speed);
+    float lane_speed[SIMD_WIDTH];
+    simd_f w = simd_set1(width);
+    simd_f h = simd_set1(height);
+    simd_f d = simd_set1(depth);
+
+    for (; i + SIMD_WIDTH <= end; i += SIMD_WIDTH) {
+        simd_f vx = simd_add(simd_load(s->vx + i), simd_load(s->ax + i));
+        simd_f vy = simd_add(simd_load(s->vy + i), simd_load(s->ay + i));
+        simd_f vz = simd_add(simd_load(s->vz + i), simd_load(s->az + i));
+
+        if (s->group_count > 1) {
+            for (int l = 0; l < SIMD_WIDTH; l++) {
+                lane_speed[l] = s->groups[s->group[i + l]].max_speed;
+            }
+            max_speed = simd_load(lane_speed);
+        }
+        simd_f mag = simd_sqrt(simd_add(simd_add(simd_mul(vx, vx), simd_mul(vy, vy)), simd_mul(vz, vz)));
+        simd_f over = simd_gt(mag, max_speed);
+        vx = simd_select(over, simd_mul(simd_div(vx, mag), max_speed), vx);
+        vy = simd_select(over, simd_mul(simd_div(vy, mag), max_speed), vy);
+        vz = simd_select(over, simd_mul(simd_div(vz, mag), max_speed), vz);
+
+        simd_store(s->vx + i, vx);
+        simd_store(s->vy + i, vy);
+        simd_store(s->vz + i, vz);
+        simd_store(s->x + i, simd_wrap(simd_add(simd_load(s->x + i), vx), zero, w));
+        simd_store(s->y + i, simd_wrap(simd_add(simd_load(s->y + i), vy), zero, h));
+        simd_store(s->z + i, simd_wrap(simd_add(simd_load(s->z + i), vz), zero, d));
+        simd_store(s->ax + i, zero);
+        simd_store(s->ay + i, zero);
+        simd_store(s->az + i, zero);
+    }
+#endif
+
+    for (; i < end; i++) {
+        particle_soa_update(s, i);
+        particle_soa_wrap(s, i, width, height, depth);
+    }
+}
+
+static inline float wrap_coord(float p, float extent) {
+    if (p > extent) p = 0.0f;
+    if (p < 0.0f) p = extent;
+    return p;
+}
+
+void particle_soa_integrate_into(const ParticleSoA* front, ParticleSoA* back, int idx,
+                                 const Vector3D* accel, float width, float height, float depth) {
+    Vector3D velocity = vec3_create(front->vx[idx] + accel->x,
+                                    front->vy[idx] + accel->y,
+                                    front->vz[idx] + accel->z);
+    velocity = vec3_clamp(velocity, front->groups[front->group[idx]].max_speed);
+
+    back->vx[idx] = velocity.x;
+    back->vy[idx] = velocity.y;
+    back->vz[idx] = velocity.z;
+    back->x[idx] = wrap_coord(front->x[idx] + velocity.x, width);
+    back->y[idx] = wrap_coord(front->y[idx] + velocity.y, height);
+    back->z[idx] = wrap_coord(front->z[idx] + velocity.z, depth);
+    back->ax[idx] = 0.0f;
+    back->ay[idx] = 0.0f;
+    back->az[idx] = 0.0f;
+}
+
+void particle_soa_swap(ParticleSoA** front, ParticleSoA** back) {
+    ParticleSoA* tmp = *front;
+    *front = *back;
+    *back = tmp;
+    (*front)->count = (*back)->count;
+
+    // Handles describe slot identity, not frame state, so they stay with
+    // whichever buffer is currently in front.
+    int* handle_of_slot = (*front)->handle_of_slot;
+    int* slot_of_handle = (*front)->slot_of_handle;
+    (*front)->handle_of_slot = (*back)->handle_of_slot;
+    (*front)->slot_of_handle = (*back)->slot_of_handle;
+    (*back)->handle_of_slot = handle_of_slot;
+    (*back)->slot_of_handle = slot_of_handle;
+    // Group ids follow the slots the same way.
+    uint8_t* group = (*front)->group;
+    (*front)->group = (*back)->group;
+    (*back)->group = group;
+}
+
+static void permute_array(float* array, float* scratch, const int* order, int count) {
+    for (int i = 0; i < count; i++) {
+        scratch[i] = array[order[i]];
+    }
+    memcpy(array, scratch, sizeof(float) * count);
+}
+
+void particle_soa_permute(ParticleSoA* s, const int* order) {
+    float* arrays[] = {s->x, s->y, s->z, s->vx, s->vy, s->vz, s->ax, s->ay, s->az};
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+        permute_array(arrays[i], s->scratch, order, s->count);
+    }
+
+    // order[] is new -> old; remap[] is old -> new for callers holding slots.
+    int* handles = (int*)s->scratch;
+    for (int i = 0; i < s->count; i++) {
+        s->remap[order[i]] = i;
+        handles[i] = s->handle_of_slot[order[i]];
+    }
+    for (int i = 0; i < s->count; i++) {
+        s->handle_of_slot[i] = handles[i];
+        s->slot_of_handle[handles[i]] = i;
+    }
+    uint8_t* groups = (uint8_t*)s->scratch;
+    for (int i = 0; i < s->count; i++) {
+        groups[i] = s->group[order[i]];
+    }
+    memcpy(s->group, groups, s->count);
+}
+
+int particle_soa_slot_of(const ParticleSoA* s, int handle) {
+    return s->slot_of_handle[handle];
+}
+
+const char* particle_soa_simd_name(void) {
+    return SIMD_NAME;
+}
@@ -0,0 +1,114 @@
+#ifndef PARTICLE_SOA_H
+#define PARTICLE_SOA_H
+
+#include <stdint.h>
+#include "flock_group.h"
+#include "particle.h"
+
+#define PARTICLE_SOA_ALIGNMENT 32
+
+// Structure-of-arrays particle store. Each component lives in its own
+// aligned array so the flocking kernel only touches the bytes it reads.
+typedef struct {
+    float *x, *y, *z;
+    float *vx, *vy, *vz;
+    float *ax, *ay, *az;
+    uint8_t *group;  // index into groups, per slot
+    int count;
+    int capacity;
+    FlockGroup groups[MAX_FLOCK_GROUPS];
+    int group_count;
+    // When set, neighbor offsets use the minimum image across a world of
+    // period_x x period_y x period_z, matching the wrap in integration.
+    int periodic;
+    float period_x, period_y, period_z;
+    float *scratch;
+    int *order;
+    // Slots move when the store is permuted; handles (the spawn index) don't.
+    // remap[old_slot] = new_slot after the most recent permutation.
+    int *remap;
+    int *handle_of_slot;
+    int *slot_of_handle;
+} ParticleSoA;
+
+ParticleSoA *particle_soa_create(int capacity);
+void particle_soa_destroy(ParticleSoA *s);
+int particle_soa_spawn(ParticleSoA *s, float x, float y, float z);
+// Bulk spawn in one pass over the arrays. claim appends count slots (fewer
+// if capacity runs out) and returns the first; fill_random then writes
+// random positions in [0, width) x [0, height) x [0, depth) and speed-2
+// headings into slots [begin, end). Slot i's values depend only on seed and
+// i, so the fill can be split across threads in any way.
+int particle_soa_claim(ParticleSoA *s, int count);
+void particle_soa_fill_random(ParticleSoA *s, int begin, int end, uint64_t seed,
+                              float width, float height, float depth);
+// claim + fill_random on the calling thread; returns the number spawned.
+int particle_soa_spawn_bulk(ParticleSoA *s, int count, uint64_t seed,
+                            float width, float height, float depth);
+// Grows every array to hold capacity particles, keeping the current ones.
+// Returns -1 (store unchanged in size) if an allocation fails.
+int particle_soa_reserve(ParticleSoA *s, int capacity);
+// Removes the most recently spawned particles until count remain. Survivors
+// are compacted in slot order; order and remap describe the move, with
+// remap[old_slot] = -1 for removed slots.
+void particle_soa_truncate(ParticleSoA *s, int count);
+void particle_soa_from_aos(ParticleSoA *s, const Particle *particles, int count);
+void particle_soa_to_aos(const ParticleSoA *s, Particle *particles);
+void particle_soa_set_periodic(ParticleSoA *s, int periodic,
+                               float width, float height, float depth);
+// Replaces the group table. When the number of groups changes every
+// particle is reassigned to group handle % count, so groups stay evenly
+// mixed; otherwise ids are kept. New particles are assigned the same way.
+void particle_soa_set_groups(ParticleSoA *s, const FlockGroup *groups, int count);
+// Fastest max_speed of any group.
+float particle_soa_max_speed(const ParticleSoA *s);
+
+// SIMD kernel (AVX2, SSE2 or wasm128, picked at compile time). Falls back to
+// particle_soa_flock_scalar when no vector ISA is enabled.
+void particle_soa_flock(ParticleSoA *s, int particle_idx,
+                        const int *neighbors, int neighbor_count,
+                        const Vector3D *leader1, const Vector3D *leader2,
+                        float perception_radius, float separation_weight);
+// Returns the steering acceleration instead of accumulating it; reads s only.
+Vector3D particle_soa_flock_accel(const ParticleSoA *s, int particle_idx,
+                                  const int *neighbors, int neighbor_count,
+                                  const Vector3D *leader1, const Vector3D *leader2,
+                                  float perception_radius, float separation_weight);
+// Mean-field steering: separation from the (few) neighbors as usual, but
+// alignment and cohesion from a field of field_count particles of its own
+// group around this one (itself included), given as their summed velocity
+// and summed offset from it, e.g. spatial_grid_cell_field. Cohesion fades as
+// the field's centroid comes within the radius.
+Vector3D particle_soa_mean_field_accel(const ParticleSoA *s, int particle_idx,
+                                       const int *neighbors, int neighbor_count,
+                                       const Vector3D *offset_sum, const Vector3D *velocity_sum,
+                                       int field_count, const Vector3D *leader1,
+                                       const Vector3D *leader2, float perception_radius,
+                                       float separation_weight);
+// Scalar reference; mirrors particle_flock_optimized operation for operation.
+void particle_soa_flock_scalar(ParticleSoA *s, int particle_idx,
+                               const int *neighbors, int neighbor_count,
+                               const Vector3D *leader1, const Vector3D *leader2,
+                               float perception_radius, float separation_weight);
+
+void particle_soa_update(ParticleSoA *s, int idx);
+void particle_soa_wrap(ParticleSoA *s, int idx, float width, float height, float depth);
+// Vectorised update + wrap over [begin, end).
+void particle_soa_integrate_range(ParticleSoA *s, int begin, int end,
+                                  float width, float height, float depth);
+
+// Double-buffered (Jacobi) integration: reads frame N from front and writes
+// frame N+1 into back, so no particle ever sees a neighbor that has already
+// moved this frame. Swap the pointers once every particle has been written.
+void particle_soa_integrate_into(const ParticleSoA *front, ParticleSoA *back, int idx,
+                                 const Vector3D *accel, float width, float height, float depth);
+void particle_soa_swap(ParticleSoA **front, ParticleSoA **back);
+
+// Reorders every array so that slot i holds what was in slot order[i], and
+// updates remap and the handle tables to match.
+void particle_soa_permute(ParticleSoA *s, const int *order);
+int particle_soa_slot_of(const ParticleSoA *s, int handle);
+
+const char *particle_soa_simd_name(void);
+
+#endif
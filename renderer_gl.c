@@ -0,0 +1,279 @@
+#define GL_GLEXT_PROTOTYPES
+#include "renderer_gl.h"
+#include "trace.h"
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Regions of the persistent buffer in flight at once. The CPU fills one
+// while the GPU may still be reading the previous two.
+#define STREAM_REGIONS 3
+// x, y, z, then the draw order as 32-bit element indices.
+#define REGION_STREAMS 4
+#define MIN_CAPACITY 1024
+
+struct RendererGL {
+    GLuint program;
+    GLuint vao;
+    GLuint vbo;
+    GLint bounds_uniform;
+    float width, height, depth;
+
+    PFNGLBUFFERSTORAGEPROC buffer_storage;  // NULL = orphan-and-refill path
+    int capacity;                           // particles per region
+    float *mapped;                          // persistent mapping, all regions
+    GLsync fences[STREAM_REGIONS];
+    int region;
+};
+
+// Each region holds capacity x values, then y, then z, so the three SoA
+// arrays are copied with a memcpy each rather than interleaved. A depth
+// order goes in the fourth stream and is drawn as an element list, so the
+// positions never need gathering.
+static const char *vertex_shader_src =
+    "#version 330 core\n"
+    "layout(location = 0) in float x;\n"
+    "layout(location = 1) in float y;\n"
+    "layout(location = 2) in float z;\n"
+    "uniform vec3 bounds;\n"
+    "out float v_gray;\n"
+    "void main() {\n"
+    "    float t = z / bounds.z;\n"
+    "    gl_Position = vec4(2.0 * x / bounds.x - 1.0, 1.0 - 2.0 * y / bounds.y, 0.0, 1.0);\n"
+    "    gl_PointSize = 1.0 + (1.0 - t) * 2.0;\n"
+    "    v_gray = t * 0.863;\n"
+    "}\n";
+
+// Core profile has no GL_POINT_SMOOTH, so points are rounded here.
+static const char *fragment_shader_src =
+    "#version 330 core\n"
+    "in float v_gray;\n"
+    "out vec4 frag_color;\n"
+    "void main() {\n"
+    "    float r = length(gl_PointCoord - vec2(0.5));\n"
+    "    frag_color = vec4(vec3(v_gray), 1.0 - smoothstep(0.35, 0.5, r));\n"
+    "}\n";
+
+static GLuint compile_shader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char info_log[512];
+        glGetShaderInfoLog(shader, sizeof(info_log), NULL, info_log);
+        fprintf(stderr, "Shader compilation failed: %s\n", info_log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static GLuint link_program(void) {
+    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_shader_src);
+    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_shader_src);
+    if (!vertex_shader || !fragment_shader) {
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    glLinkProgram(program);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char info_log[512];
+        glGetProgramInfoLog(program, sizeof(info_log), NULL, info_log);
+        fprintf(stderr, "Program linking failed: %s\n", info_log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+static int has_buffer_storage(void) {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 4 || (major == 4 && minor >= 4)) return 1;
+
+    GLint num_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+    for (int i = 0; i < num_extensions; i++) {
+        const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (name && strcmp(name, "GL_ARB_buffer_storage") == 0) return 1;
+    }
+    return 0;
+}
+
+static void wait_region(RendererGL* r, int region) {
+    if (!r->fences[region]) return;
+    while (glClientWaitSync(r->fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) ==
+           GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(r->fences[region]);
+    r->fences[region] = 0;
+}
+
+static void release_buffer(RendererGL* r) {
+    for (int i = 0; i < STREAM_REGIONS; i++) {
+        wait_region(r, i);
+    }
+    if (r->mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, r->vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        r->mapped = NULL;
+    }
+    glDeleteBuffers(1, &r->vbo);
+    r->vbo = 0;
+}
+
+// Immutable storage can't be resized, so growing swaps in a new buffer.
+static void ensure_capacity(RendererGL* r, int count) {
+    if (r->vbo && count <= r->capacity) return;
+
+    int capacity = r->capacity > 0 ? r->capacity : MIN_CAPACITY;
+    while (capacity < count) capacity *= 2;
+
+    if (r->vbo) release_buffer(r);
+    r->capacity = capacity;
+    r->region = 0;
+
+    glGenBuffers(1, &r->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, r->vbo);
+    if (r->buffer_storage) {
+        GLsizeiptr size = (GLsizeiptr)sizeof(float) * REGION_STREAMS * capacity * STREAM_REGIONS;
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        r->buffer_storage(GL_ARRAY_BUFFER, size, NULL, flags);
+        r->mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        if (!r->mapped) {
+            // Driver advertised storage but won't map it; fall back for good.
+            fprintf(stderr, "Persistent mapping failed, streaming with glBufferData\n");
+            r->buffer_storage = NULL;
+            glDeleteBuffers(1, &r->vbo);
+            r->vbo = 0;
+            ensure_capacity(r, count);
+        }
+    }
+}
+
+RendererGL* renderer_gl_create(float width, float height, float depth,
+                               RendererGLLoader loader) {
+    GLuint program = link_program();
+    if (!program) return NULL;
+
+    RendererGL* r = calloc(1, sizeof(RendererGL));
+    r->program = program;
+    r->bounds_uniform = glGetUniformLocation(program, "bounds");
+    renderer_gl_set_bounds(r, width, height, depth);
+
+    if (loader && has_buffer_storage()) {
+        r->buffer_storage = (PFNGLBUFFERSTORAGEPROC)loader("glBufferStorage");
+    }
+
+    glGenVertexArrays(1, &r->vao);
+    glBindVertexArray(r->vao);
+    for (GLuint i = 0; i < 3; i++) {
+        glEnableVertexAttribArray(i);
+    }
+    ensure_capacity(r, MIN_CAPACITY);
+
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    return r;
+}
+
+void renderer_gl_destroy(RendererGL* r) {
+    if (!r) return;
+    release_buffer(r);
+    glDeleteVertexArrays(1, &r->vao);
+    glDeleteProgram(r->program);
+    free(r);
+}
+
+void renderer_gl_set_bounds(RendererGL* r, float width, float height, float depth) {
+    r->width = width;
+    r->height = height;
+    r->depth = depth;
+}
+
+int renderer_gl_is_persistent(const RendererGL* r) {
+    return r->mapped != NULL;
+}
+
+void renderer_gl_draw(RendererGL* r, const ParticleSoA* particles, const int* order) {
+    int count = particles->count;
+    if (count <= 0) return;
+
+    glBindVertexArray(r->vao);
+    ensure_capacity(r, count);
+    glBindBuffer(GL_ARRAY_BUFFER, r->vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r->vbo);
+
+    size_t bytes = sizeof(float) * count;
+    size_t stream_bytes = sizeof(float) * r->capacity;
+    size_t offset = 0;
+    trace_begin("upload");
+    if (r->mapped) {
+        wait_region(r, r->region);
+        offset = stream_bytes * REGION_STREAMS * r->region;
+        float* dst = r->mapped + REGION_STREAMS * r->capacity * r->region;
+        memcpy(dst, particles->x, bytes);
+        memcpy(dst + r->capacity, particles->y, bytes);
+        memcpy(dst + 2 * r->capacity, particles->z, bytes);
+        if (order) memcpy(dst + 3 * r->capacity, order, sizeof(int) * count);
+    } else {
+        // Orphaning hands the old storage to the driver, so the upload
+        // never waits on the previous frame's draw.
+        glBufferData(GL_ARRAY_BUFFER, stream_bytes * REGION_STREAMS, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, particles->x);
+        glBufferSubData(GL_ARRAY_BUFFER, stream_bytes, bytes, particles->y);
+        glBufferSubData(GL_ARRAY_BUFFER, stream_bytes * 2, bytes, particles->z);
+        if (order) glBufferSubData(GL_ARRAY_BUFFER, stream_bytes * 3, sizeof(int) * count, order);
+    }
+    trace_end();
+
+    for (GLuint i = 0; i < 3; i++) {
+        size_t stream = offset + stream_bytes * i;
+        glVertexAttribPointer(i, 1, GL_FLOAT, GL_FALSE, sizeof(float), (const void*)stream);
+    }
+
+    glUseProgram(r->program);
+    glUniform3f(r->bounds_uniform, r->width, r->height, r->depth);
+    if (order) {
+        glDrawElements(GL_POINTS, count, GL_UNSIGNED_INT, (const void*)(offset + stream_bytes * 3));
+    } else {
+        glDrawArrays(GL_POINTS, 0, count);
+    }
+
+    if (r->mapped) {
+        r->fences[r->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        r->region = (r->region + 1) % STREAM_REGIONS;
+    }
+}
+
+void renderer_gl_draw_buffer(RendererGL* r, unsigned int buffer, int count) {
+    if (count <= 0) return;
+
+    glBindVertexArray(r->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (GLuint i = 0; i < 3; i++) {
+        glVertexAttribPointer(i, 1, GL_FLOAT, GL_FALSE, 4 * sizeof(float),
+                              (const void*)(sizeof(float) * i));
+    }
+
+    glUseProgram(r->program);
+    glUniform3f(r->bounds_uniform, r->width, r->height, r->depth);
+    glDrawArrays(GL_POINTS, 0, count);
+}
@@ -0,0 +1,34 @@
+#ifndef RENDERER_GL_H
+#define RENDERER_GL_H
+
+#include "particle_soa.h"
+
+// Native point renderer for a GL 3.3 core context: the x, y and z arrays
+// are copied straight into a streamed vertex buffer and drawn with one
+// draw call. Point size and shade come from z in the vertex shader.
+typedef struct RendererGL RendererGL;
+
+// Matches GLFWglproc, so glfwGetProcAddress can be passed directly.
+typedef void (*RendererGLProc)(void);
+typedef RendererGLProc (*RendererGLLoader)(const char *name);
+
+// width/height/depth are the simulation bounds mapped onto the viewport.
+// The loader is only used for GL 4.4 buffer storage; without it the
+// renderer orphans and refills a plain buffer each frame. Returns NULL if
+// the shaders fail to build.
+RendererGL *renderer_gl_create(float width, float height, float depth,
+                               RendererGLLoader loader);
+void renderer_gl_destroy(RendererGL *renderer);
+
+void renderer_gl_set_bounds(RendererGL *renderer, float width, float height, float depth);
+// order, if set, lists count slots in draw order (flock_world_depth_order);
+// it is drawn as an element list, so the positions still go up as is.
+void renderer_gl_draw(RendererGL *renderer, const ParticleSoA *particles, const int *order);
+// Draws count vec4 positions straight from a buffer object the caller
+// owns, such as gpu_flock_position_buffer.
+void renderer_gl_draw_buffer(RendererGL *renderer, unsigned int buffer, int count);
+
+// 1 if positions go through a persistently mapped buffer.
+int renderer_gl_is_persistent(const RendererGL *renderer);
+
+#endif
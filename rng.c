@@ -0,0 +1,45 @@
+#include "rng.h"
+#include <math.h>
+
+#define RNG_THREAD_SEED 0x5EED5EEDULL
+#define GOLDEN_GAMMA 0x9E3779B97F4A7C15ULL
+
+// splitmix64 finaliser: spreads nearby seeds over the whole state space.
+static uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void rng_seed(Rng* rng, uint64_t seed) {
+    rng->state = mix64(seed + GOLDEN_GAMMA);
+    if (rng->state == 0) rng->state = GOLDEN_GAMMA;  // xorshift's one fixed point
+}
+
+Rng rng_stream(uint64_t seed, uint64_t index) {
+    Rng rng;
+    rng_seed(&rng, mix64(seed) + index * GOLDEN_GAMMA);
+    return rng;
+}
+
+Vector3D rng_unit_vector(Rng* rng) {
+    float a, b, s;
+    do {
+        a = rng_float(rng) * 2.0f - 1.0f;
+        b = rng_float(rng) * 2.0f - 1.0f;
+        s = a * a + b * b;
+    } while (s >= 1.0f || s == 0.0f);
+
+    float r = 2.0f * sqrtf(1.0f - s);
+    return vec3_create(a * r, b * r, 1.0f - 2.0f * s);
+}
+
+Rng* rng_thread(void) {
+    static _Thread_local Rng rng;
+    static _Thread_local int seeded;
+    if (!seeded) {
+        rng_seed(&rng, RNG_THREAD_SEED);
+        seeded = 1;
+    }
+    return &rng;
+}
@@ -0,0 +1,40 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+#include "vector3d.h"
+
+// xorshift64* generator. Tiny, lock-free and identical on every platform,
+// unlike rand(). Keep one per world or per thread.
+typedef struct {
+    uint64_t state;
+} Rng;
+
+void rng_seed(Rng *rng, uint64_t seed);
+
+// Independent generator for item `index` of a batch, so work split across
+// threads draws the same numbers as a serial pass.
+Rng rng_stream(uint64_t seed, uint64_t index);
+
+// Uniform direction without trig (Marsaglia's disc method).
+Vector3D rng_unit_vector(Rng *rng);
+
+// The calling thread's generator, used by the seedless helpers such as
+// vec3_random3d. Starts from a fixed seed on every thread.
+Rng *rng_thread(void);
+
+static inline uint64_t rng_next(Rng *rng) {
+    uint64_t x = rng->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng->state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+// [0, 1) with 24 bits of precision.
+static inline float rng_float(Rng *rng) {
+    return (float)(rng_next(rng) >> 40) * (1.0f / 16777216.0f);
+}
+
+#endif
@@ -0,0 +1,17 @@
+#!/usr/bin/env python3
+# Static server for the browser build. The COOP/COEP headers make the page
+# cross-origin isolated, which the threaded build needs for SharedArrayBuffer.
+import http.server
+import sys
+
+
+class IsolatedHandler(http.server.SimpleHTTPRequestHandler):
+    def end_headers(self):
+        self.send_header("Cross-Origin-Opener-Policy", "same-origin")
+        self.send_header("Cross-Origin-Embedder-Policy", "require-corp")
+        super().end_headers()
+
+
+if __name__ == "__main__":
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 8080
+    http.server.ThreadingHTTPServer(("", port), IsolatedHandler).serve_forever()
@@ -0,0 +1,393 @@
+#define _POSIX_C_SOURCE 200809L
+#include "sim_thread.h"
+#include "trace.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define SIM_THREAD_INLINE 1
+#else
+#define SIM_THREAD_INLINE 0
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Once the sim is this many steps behind it drops the backlog instead of
+// running flat out to catch up.
+#define MAX_CATCH_UP_STEPS 4
+// Set on the ready slot when it holds a snapshot (or input) the reader
+// hasn't taken.
+#define SNAPSHOT_FRESH 4
+
+typedef struct {
+    float *x0, *y0, *z0;  // previous frame, by handle
+    float *x1, *y1, *z1;  // this frame, by handle
+    float *vx, *vy, *vz;  // this frame's velocities, by handle
+    int *order;           // handles back to front
+    int has_order;
+    int count;
+    int capacity;
+    float max_step;  // longer moves between frames are wraps, not motion
+    uint64_t frame;
+    double due;      // clock time this frame was scheduled for
+} Snapshot;
+
+// Renderer input, handed to the sim through the same kind of triple buffer
+// as the snapshots but in the other direction.
+typedef struct {
+    Vector3D target;
+    int follow_target;
+} SimInput;
+
+struct SimThread {
+    FlockWorld* world;
+    double dt;
+    double due;  // when the next step should run
+    uint64_t frame;
+    int paused;
+
+    // Triple buffer: the writer fills write_slot, then swaps it with ready;
+    // the reader swaps read_slot with ready whenever ready is fresh.
+    Snapshot snapshots[3];
+    int write_slot;
+    atomic_int ready;
+    int read_slot;
+
+    SimInput inputs[3];
+    int input_write;
+    atomic_int input_ready;
+    int input_read;
+
+    ParticleSoA* view_particles;
+    SimView view;
+    TrajectoryRecorder* recorder;
+
+#if !SIM_THREAD_INLINE
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    atomic_int waiting;  // threads blocked in sim_thread_lock
+    int shutdown;
+#endif
+};
+
+double sim_thread_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int grow_array(void** array, size_t elem_size, int capacity) {
+    void* grown = realloc(*array, elem_size * capacity);
+    if (!grown) return -1;
+    *array = grown;
+    return 0;
+}
+
+static int reserve_snapshot(Snapshot* snap, int capacity) {
+    if (capacity <= snap->capacity) return 0;
+    float** arrays[] = {&snap->x0, &snap->y0, &snap->z0, &snap->x1, &snap->y1, &snap->z1,
+                        &snap->vx, &snap->vy, &snap->vz};
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+        if (grow_array((void**)arrays[i], sizeof(float), capacity) != 0) return -1;
+    }
+    if (grow_array((void**)&snap->order, sizeof(int), capacity) != 0) return -1;
+    snap->capacity = capacity;
+    return 0;
+}
+
+static void free_snapshot(Snapshot* snap) {
+    free(snap->x0);
+    free(snap->y0);
+    free(snap->z0);
+    free(snap->x1);
+    free(snap->y1);
+    free(snap->z1);
+    free(snap->vx);
+    free(snap->vy);
+    free(snap->vz);
+    free(snap->order);
+}
+
+static void scatter_positions(const ParticleSoA* p, float* x, float* y, float* z) {
+    for (int i = 0; i < p->count; i++) {
+        int handle = p->handle_of_slot[i];
+        x[handle] = p->x[i];
+        y[handle] = p->y[i];
+        z[handle] = p->z[i];
+    }
+}
+
+static void scatter_velocities(const ParticleSoA* p, Snapshot* snap) {
+    for (int i = 0; i < p->count; i++) {
+        int handle = p->handle_of_slot[i];
+        snap->vx[handle] = p->vx[i];
+        snap->vy[handle] = p->vy[i];
+        snap->vz[handle] = p->vz[i];
+    }
+}
+
+// Hands the finished write slot to the reader and takes back whichever
+// slot the reader isn't holding.
+static void publish(SimThread* sim) {
+    int old = atomic_exchange(&sim->ready, sim->write_slot | SNAPSHOT_FRESH);
+    sim->write_slot = old & ~SNAPSHOT_FRESH;
+}
+
+// Applies the newest posted input, if there is one the sim hasn't seen.
+static void take_input(SimThread* sim) {
+    if (!(atomic_load(&sim->input_ready) & SNAPSHOT_FRESH)) return;
+    int old = atomic_exchange(&sim->input_ready, sim->input_read);
+    sim->input_read = old & ~SNAPSHOT_FRESH;
+    const SimInput* input = &sim->inputs[sim->input_read];
+    flock_world_set_target(sim->world, input->follow_target ? &input->target : NULL);
+}
+
+// One fixed step scheduled for due. Runs with the lock held.
+static void run_step(SimThread* sim, double due) {
+    take_input(sim);
+    Snapshot* snap = &sim->snapshots[sim->write_slot];
+    const ParticleSoA* particles = flock_world_particles(sim->world);
+    if (reserve_snapshot(snap, particles->count) != 0) {
+        flock_world_step(sim->world);
+        return;
+    }
+
+    // Slots move during the step; handles don't.
+    trace_begin("snapshot");
+    scatter_positions(particles, snap->x0, snap->y0, snap->z0);
+    trace_end();
+    flock_world_step(sim->world);
+    trace_begin("snapshot");
+    particles = flock_world_particles(sim->world);
+    scatter_positions(particles, snap->x1, snap->y1, snap->z1);
+    scatter_velocities(particles, snap);
+
+    const int* order = flock_world_depth_order(sim->world);
+    snap->has_order = order != NULL;
+    if (order) {
+        for (int i = 0; i < particles->count; i++) {
+            snap->order[i] = particles->handle_of_slot[order[i]];
+        }
+    }
+    snap->count = particles->count;
+    snap->max_step = 2.0f * particle_soa_max_speed(particles);
+    snap->frame = ++sim->frame;
+    snap->due = due;
+    publish(sim);
+    trace_end();
+
+    if (sim->recorder) {
+        trace_begin("record");
+        trajectory_recorder_push(sim->recorder, particles, snap->frame);
+        trace_end();
+    }
+}
+
+// Runs the steps due by now, at most MAX_CATCH_UP_STEPS of them.
+static void run_due_steps(SimThread* sim, double now) {
+    if (now - sim->due > MAX_CATCH_UP_STEPS * sim->dt) sim->due = now;
+    for (int i = 0; i < MAX_CATCH_UP_STEPS && sim->due <= now; i++) {
+        run_step(sim, sim->due);
+        sim->due += sim->dt;
+    }
+}
+
+#if !SIM_THREAD_INLINE
+static struct timespec to_timespec(double seconds) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    return ts;
+}
+
+static void* sim_main(void* arg) {
+    SimThread* sim = (SimThread*)arg;
+    trace_set_thread_name("sim");
+    pthread_mutex_lock(&sim->mutex);
+    while (!sim->shutdown) {
+        double now = sim_thread_now();
+        if (sim->paused) {
+            pthread_cond_wait(&sim->wake, &sim->mutex);
+            continue;
+        }
+        if (now < sim->due) {
+            struct timespec until = to_timespec(sim->due);
+            pthread_cond_timedwait(&sim->wake, &sim->mutex, &until);
+            continue;
+        }
+        run_due_steps(sim, now);
+
+        // A sim that can't keep up never sleeps, so let lockers in between
+        // batches rather than relying on the mutex being fair.
+        if (atomic_load(&sim->waiting) > 0) {
+            pthread_mutex_unlock(&sim->mutex);
+            while (atomic_load(&sim->waiting) > 0) sched_yield();
+            pthread_mutex_lock(&sim->mutex);
+        }
+    }
+    pthread_mutex_unlock(&sim->mutex);
+    return NULL;
+}
+#endif
+
+SimThread* sim_thread_create(FlockWorld* world, double dt) {
+    SimThread* sim = calloc(1, sizeof(SimThread));
+    sim->world = world;
+    sim->dt = dt;
+    sim->view_particles = particle_soa_create(flock_world_particles(world)->count);
+
+    // Frame 0 is published up front so there is always something to draw.
+    Snapshot* first = &sim->snapshots[0];
+    const ParticleSoA* particles = flock_world_particles(world);
+    reserve_snapshot(first, particles->count);
+    scatter_positions(particles, first->x0, first->y0, first->z0);
+    scatter_positions(particles, first->x1, first->y1, first->z1);
+    scatter_velocities(particles, first);
+    first->count = particles->count;
+    first->due = sim_thread_now();
+    sim->write_slot = 0;
+    atomic_init(&sim->ready, 2);
+    publish(sim);
+    sim->read_slot = 1;
+    sim->due = first->due + dt;
+    sim->input_write = 0;
+    atomic_init(&sim->input_ready, 1);
+    sim->input_read = 2;
+
+#if !SIM_THREAD_INLINE
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sim->wake, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&sim->mutex, NULL);
+    atomic_init(&sim->waiting, 0);
+    pthread_create(&sim->thread, NULL, sim_main, sim);
+#endif
+    return sim;
+}
+
+void sim_thread_destroy(SimThread* sim) {
+    if (!sim) return;
+#if !SIM_THREAD_INLINE
+    pthread_mutex_lock(&sim->mutex);
+    sim->shutdown = 1;
+    pthread_cond_signal(&sim->wake);
+    pthread_mutex_unlock(&sim->mutex);
+    pthread_join(sim->thread, NULL);
+    pthread_cond_destroy(&sim->wake);
+    pthread_mutex_destroy(&sim->mutex);
+#endif
+    for (int i = 0; i < 3; i++) {
+        free_snapshot(&sim->snapshots[i]);
+    }
+    particle_soa_destroy(sim->view_particles);
+    free(sim);
+}
+
+FlockWorld* sim_thread_lock(SimThread* sim) {
+#if !SIM_THREAD_INLINE
+    atomic_fetch_add(&sim->waiting, 1);
+    pthread_mutex_lock(&sim->mutex);
+    atomic_fetch_sub(&sim->waiting, 1);
+#endif
+    return sim->world;
+}
+
+void sim_thread_unlock(SimThread* sim) {
+#if !SIM_THREAD_INLINE
+    pthread_mutex_unlock(&sim->mutex);
+#else
+    (void)sim;
+#endif
+}
+
+void sim_thread_set_paused(SimThread* sim, int paused) {
+    if (sim->paused && !paused) sim->due = sim_thread_now();
+    sim->paused = paused;
+#if !SIM_THREAD_INLINE
+    pthread_cond_signal(&sim->wake);
+#endif
+}
+
+void sim_thread_set_target(SimThread* sim, const Vector3D* target) {
+    SimInput* input = &sim->inputs[sim->input_write];
+    input->follow_target = target != NULL;
+    if (target) input->target = *target;
+    int old = atomic_exchange(&sim->input_ready, sim->input_write | SNAPSHOT_FRESH);
+    sim->input_write = old & ~SNAPSHOT_FRESH;
+}
+
+void sim_thread_set_recorder(SimThread* sim, TrajectoryRecorder* rec) {
+    sim->recorder = rec;
+}
+
+void sim_thread_pump(SimThread* sim) {
+#if SIM_THREAD_INLINE
+    if (!sim->paused) run_due_steps(sim, sim_thread_now());
+#else
+    (void)sim;
+#endif
+}
+
+static float blend(float a, float b, float t, float max_step) {
+    float d = b - a;
+    return fabsf(d) > max_step ? b : a + d * t;
+}
+
+const SimView* sim_thread_view(SimThread* sim) {
+    int ready = atomic_load(&sim->ready);
+    if (ready & SNAPSHOT_FRESH) {
+        int old = atomic_exchange(&sim->ready, sim->read_slot);
+        sim->read_slot = old & ~SNAPSHOT_FRESH;
+    }
+    const Snapshot* snap = &sim->snapshots[sim->read_slot];
+
+    // The reader holds this snapshot until its next call, so the order can
+    // be handed out as is. Velocities are copied next to the positions so
+    // their pointers stay put across snapshots (main_wasm.c exports them).
+    int count = snap->count;
+    ParticleSoA* out = sim->view_particles;
+    if (particle_soa_reserve(out, count) != 0) {
+        // Keep drawing the last good frame; before there is one, nothing.
+        // The order belongs to a snapshot the writer may now reuse.
+        if (!sim->view.particles) {
+            out->count = 0;
+            sim->view.particles = out;
+            sim->view.vx = out->vx;
+            sim->view.vy = out->vy;
+            sim->view.vz = out->vz;
+        }
+        sim->view.order = NULL;
+        return &sim->view;
+    }
+
+    trace_begin("interpolate");
+    float t = (float)((sim_thread_now() - snap->due) / sim->dt);
+    if (t < 0.0f) t = 0.0f;
+    if (t > 1.0f) t = 1.0f;
+
+    for (int h = 0; h < count; h++) {
+        out->x[h] = blend(snap->x0[h], snap->x1[h], t, snap->max_step);
+        out->y[h] = blend(snap->y0[h], snap->y1[h], t, snap->max_step);
+        out->z[h] = blend(snap->z0[h], snap->z1[h], t, snap->max_step);
+    }
+    memcpy(out->vx, snap->vx, sizeof(float) * count);
+    memcpy(out->vy, snap->vy, sizeof(float) * count);
+    memcpy(out->vz, snap->vz, sizeof(float) * count);
+    out->count = count;
+    trace_end();
+
+    sim->view.particles = out;
+    sim->view.order = snap->has_order ? snap->order : NULL;
+    sim->view.vx = out->vx;
+    sim->view.vy = out->vy;
+    sim->view.vz = out->vz;
+    sim->view.frame = snap->frame;
+    sim->view.alpha = t;
+    return &sim->view;
+}
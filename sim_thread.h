@@ -0,0 +1,62 @@
+#ifndef SIM_THREAD_H
+#define SIM_THREAD_H
+
+#include <stdint.h>
+#include "flock_world.h"
+#include "particle_soa.h"
+#include "trajectory.h"
+
+// Steps a FlockWorld at a fixed dt on its own thread, independent of the
+// render rate. Each step is published as a snapshot through a triple
+// buffer, so the renderer never waits on the simulation and always sees a
+// whole frame; it draws a blend of the last two frames at the current
+// time. Without pthreads (the default wasm build) the same steps run
+// inline from sim_thread_pump.
+typedef struct SimThread SimThread;
+
+// What the renderer draws this frame. Positions are in handle order, not
+// slot order, so consecutive snapshots line up however the slots moved.
+typedef struct {
+    const ParticleSoA *particles;  // x, y, z and count only
+    const int *order;              // handles back to front; NULL if sorting is off
+    const float *vx, *vy, *vz;     // newest frame's velocities, by handle; move only on growth
+    uint64_t frame;                // newest sim frame in the blend
+    float alpha;                   // 0 = previous frame, 1 = newest
+} SimView;
+
+// The world must outlive the sim. dt is in seconds; stepping starts at once.
+SimThread *sim_thread_create(FlockWorld *world, double dt);
+// Stops the thread after its current step.
+void sim_thread_destroy(SimThread *sim);
+
+// Anything else touching the world (config, resize, a GPU backend) goes
+// between lock and unlock; no step runs in between.
+FlockWorld *sim_thread_lock(SimThread *sim);
+void sim_thread_unlock(SimThread *sim);
+// Call with the lock held. While paused no steps run, and on resume the
+// clock restarts rather than catching up.
+void sim_thread_set_paused(SimThread *sim, int paused);
+
+// Posts the point both leaders chase (NULL resumes their orbit) without
+// taking the lock; the sim applies the newest one at the start of its next
+// step. Call from one thread only. While paused nothing reads it, so a GPU
+// backend sets its target on the world itself.
+void sim_thread_set_target(SimThread *sim, const Vector3D *target);
+
+// Call with the lock held. Every step from then on is pushed to rec right
+// after it runs; NULL stops recording. The recorder must outlive its use.
+void sim_thread_set_recorder(SimThread *sim, TrajectoryRecorder *rec);
+
+// Inline builds: runs the steps due by now. Does nothing when threaded.
+void sim_thread_pump(SimThread *sim);
+
+// Takes the newest snapshot and blends it for the current time. Call from
+// one thread only; the view is valid until the next call. If the view can't
+// grow to a new count it keeps the last frame (count 0 before the first),
+// without an order.
+const SimView *sim_thread_view(SimThread *sim);
+
+// Monotonic clock the sim schedules against, in seconds.
+double sim_thread_now(void);
+
+#endif
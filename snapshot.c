@@ -0,0 +1,170 @@
+#define _POSIX_C_SOURCE 200809L
+#include "snapshot.h"
+#include "flock_config.h"
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SNAPSHOT_ARRAYS 6
+
+_Static_assert(sizeof(SnapshotHeader) == 80, "snapshot header layout changed");
+
+// In 64 bits, so a crafted count can't wrap a 32-bit size_t (wasm).
+static uint64_t snapshot_size64(uint32_t count, uint32_t flags) {
+    uint64_t elem = (flags & SNAPSHOT_QUANTIZED) ? sizeof(uint16_t) : sizeof(float);
+    uint64_t groups = (flags & SNAPSHOT_GROUPS) ? sizeof(uint8_t) : 0;
+    return sizeof(SnapshotHeader) + (SNAPSHOT_ARRAYS * elem + groups) * count;
+}
+
+size_t snapshot_size(uint32_t count, uint32_t flags) {
+    return (size_t)snapshot_size64(count, flags);
+}
+
+static int all_finite(const float* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (!isfinite(values[i])) return 0;
+    }
+    return 1;
+}
+
+const SnapshotHeader* snapshot_check(const void* data, size_t size) {
+    if (!data || size < sizeof(SnapshotHeader)) return NULL;
+    const SnapshotHeader* header = (const SnapshotHeader*)data;
+    if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION ||
+        (header->flags & ~(SNAPSHOT_QUANTIZED | SNAPSHOT_GROUPS)) != 0 ||
+        header->count < 1 || header->count > MAX_CONFIG_PARTICLES) {
+        return NULL;
+    }
+    if ((uint64_t)size < snapshot_size64(header->count, header->flags)) return NULL;
+    const float header_floats[] = {
+        header->width, header->height, header->depth, header->max_speed,
+        header->leader1[0], header->leader1[1], header->leader1[2],
+        header->leader2[0], header->leader2[1], header->leader2[2],
+        header->leader_angle, header->separation_time};
+    if (!all_finite(header_floats, sizeof(header_floats) / sizeof(header_floats[0]))) {
+        return NULL;
+    }
+    if ((header->flags & SNAPSHOT_QUANTIZED) &&
+        !(header->width > 0.0f && header->height > 0.0f && header->depth > 0.0f &&
+          header->max_speed > 0.0f)) {
+        return NULL;
+    }
+    // Quantized values always decode to finite ones; float arrays are read
+    // in full so a NaN can't reach the grid.
+    if (!(header->flags & SNAPSHOT_QUANTIZED) &&
+        !all_finite((const float*)(header + 1), (size_t)SNAPSHOT_ARRAYS * header->count)) {
+        return NULL;
+    }
+    return header;
+}
+
+// [-max_speed, max_speed] onto 0..65535, rounded.
+static uint16_t pack_velocity(float v, float inv_speed) {
+    float t = (v * inv_speed * 0.5f + 0.5f) * 65535.0f + 0.5f;
+    if (!(t > 0.0f)) return 0;
+    return t >= 65535.0f ? 65535 : (uint16_t)t;
+}
+
+void snapshot_encode(const SnapshotHeader* header, const ParticleSoA* s, void* out) {
+    SnapshotHeader* dst = (SnapshotHeader*)out;
+    *dst = *header;
+    dst->magic = SNAPSHOT_MAGIC;
+    dst->version = SNAPSHOT_VERSION;
+    dst->count = (uint32_t)s->count;
+    dst->max_speed = particle_soa_max_speed(s);
+    dst->reserved = 0;
+
+    int count = s->count;
+    if (dst->flags & SNAPSHOT_GROUPS) {
+        memcpy((uint8_t*)out + snapshot_size(count, dst->flags) - count, s->group, count);
+    }
+    const float* arrays[SNAPSHOT_ARRAYS] = {s->x, s->y, s->z, s->vx, s->vy, s->vz};
+    if (!(dst->flags & SNAPSHOT_QUANTIZED)) {
+        float* values = (float*)(dst + 1);
+        for (int a = 0; a < SNAPSHOT_ARRAYS; a++) {
+            memcpy(values + (size_t)a * count, arrays[a], sizeof(float) * count);
+        }
+        return;
+    }
+
+    float scales[SNAPSHOT_ARRAYS] = {1.0f / dst->width, 1.0f / dst->height, 1.0f / dst->depth,
+                                     1.0f / dst->max_speed, 1.0f / dst->max_speed,
+                                     1.0f / dst->max_speed};
+    uint16_t* values = (uint16_t*)(dst + 1);
+    for (int a = 0; a < SNAPSHOT_ARRAYS; a++) {
+        uint16_t* column = values + (size_t)a * count;
+        for (int i = 0; i < count; i++) {
+            column[i] = a < 3 ? snapshot_pack_position(arrays[a][i], scales[a])
+                              : pack_velocity(arrays[a][i], scales[a]);
+        }
+    }
+}
+
+void snapshot_decode(const void* data, ParticleSoA* s) {
+    const SnapshotHeader* header = (const SnapshotHeader*)data;
+    int count = (int)header->count;
+    float* arrays[SNAPSHOT_ARRAYS] = {s->x, s->y, s->z, s->vx, s->vy, s->vz};
+
+    if (!(header->flags & SNAPSHOT_QUANTIZED)) {
+        const float* values = (const float*)(header + 1);
+        for (int a = 0; a < SNAPSHOT_ARRAYS; a++) {
+            memcpy(arrays[a], values + (size_t)a * count, sizeof(float) * count);
+        }
+    } else {
+        float speed = header->max_speed;
+        float bounds[3] = {header->width, header->height, header->depth};
+        const uint16_t* values = (const uint16_t*)(header + 1);
+        for (int a = 0; a < SNAPSHOT_ARRAYS; a++) {
+            const uint16_t* column = values + (size_t)a * count;
+            float* dst = arrays[a];
+            if (a < 3) {
+                for (int i = 0; i < count; i++) {
+                    dst[i] = snapshot_unpack_position(column[i], bounds[a]);
+                }
+            } else {
+                float scale = 2.0f * speed / 65535.0f;
+                for (int i = 0; i < count; i++) {
+                    dst[i] = column[i] * scale - speed;
+                }
+            }
+        }
+    }
+
+    if (header->flags & SNAPSHOT_GROUPS) {
+        const uint8_t* groups = (const uint8_t*)data + snapshot_size(count, header->flags) - count;
+        for (int i = 0; i < count; i++) {
+            s->group[i] = (uint8_t)(groups[i] % s->group_count);
+        }
+    } else {
+        for (int i = 0; i < count; i++) {
+            s->group[i] = (uint8_t)(i % s->group_count);
+        }
+    }
+
+    memset(s->ax, 0, sizeof(float) * count);
+    memset(s->ay, 0, sizeof(float) * count);
+    memset(s->az, 0, sizeof(float) * count);
+    s->count = count;
+}
+
+const void* snapshot_map(const char* path, size_t* size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);  // the mapping keeps the file open
+    if (data == MAP_FAILED) return NULL;
+    *size = (size_t)st.st_size;
+    return data;
+}
+
+void snapshot_unmap(const void* data, size_t size) {
+    if (data) munmap((void*)data, size);
+}
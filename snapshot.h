@@ -0,0 +1,69 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "particle_soa.h"
+
+// Binary flock snapshot: a SnapshotHeader followed by the x, y, z, vx, vy,
+// vz arrays in slot order, count values each. Arrays are float32, or with
+// SNAPSHOT_QUANTIZED uint16: positions as one of 65536 bins across width,
+// height or depth, velocities as v / max_speed in [-1, 1] mapped onto
+// 0..65535. Everything is little-endian and every array is aligned to its
+// element size, so a file can be mmap'd or wrapped in typed arrays as is.
+// SNAPSHOT_GROUPS appends one uint8 flock group id per particle; without it
+// every particle is put back in group slot % group_count.
+#define SNAPSHOT_MAGIC 0x534b4c46u  // "FLKS"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_QUANTIZED 1u
+#define SNAPSHOT_GROUPS 2u
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t count;
+    float width, height, depth;
+    float max_speed;
+    float leader1[3], leader2[3];
+    float leader_angle;
+    float separation_time;
+    uint64_t rng_state;
+    uint32_t frame;
+    uint32_t reserved;
+} SnapshotHeader;
+
+// Positions fall into one of 65536 bins across the bound and come back as
+// the bin centre, so a round trip never leaves [0, bound). Trajectories
+// (trajectory.h) quantize on the same lattice.
+static inline uint16_t snapshot_pack_position(float v, float inv_bound) {
+    float t = v * inv_bound * 65536.0f;
+    if (!(t > 0.0f)) return 0;
+    return t >= 65535.0f ? 65535 : (uint16_t)t;
+}
+
+static inline float snapshot_unpack_position(uint16_t q, float bound) {
+    return (q + 0.5f) * (bound / 65536.0f);
+}
+
+// Header plus arrays for count particles.
+size_t snapshot_size(uint32_t count, uint32_t flags);
+// The header of data if it is a snapshot this build reads, of 1 to
+// MAX_CONFIG_PARTICLES particles, size covers its arrays and every header
+// and array value is finite; NULL otherwise. Positions may still lie
+// outside the stored bounds.
+const SnapshotHeader *snapshot_check(const void *data, size_t size);
+
+// Writes header (count and max_speed, the fastest group's, taken from s)
+// and s's first count slots into out, which holds snapshot_size bytes.
+void snapshot_encode(const SnapshotHeader *header, const ParticleSoA *s, void *out);
+// Fills slots [0, count) of s from a checked snapshot, zeroing
+// accelerations. Group ids beyond s's group count wrap. s must have the
+// capacity; handles are left to the caller.
+void snapshot_decode(const void *data, ParticleSoA *s);
+
+// Maps a file read-only. Returns NULL (and leaves size alone) on failure.
+const void *snapshot_map(const char *path, size_t *size);
+void snapshot_unmap(const void *data, size_t size);
+
+#endif
@@ -1,9 +1,23 @@
 #include "spatial_grid.h"
+#include "trace.h"
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
-static inline int get_cell_index(SpatialGrid* grid, int x, int y, int z) {
+#define SUMMARY_FLOATS 7  // summed position and velocity, then the member count
+
+static inline int get_cell_index(const SpatialGrid* grid, int x, int y, int z) {
+    if (grid->hashed) {
+        unsigned h = ((unsigned)x * 73856093u) ^ ((unsigned)y * 19349663u) ^
+                     ((unsigned)z * 83492791u);
+        return (int)(h & grid->hash_mask);
+    }
+    if (grid->periodic) {
+        x = ((x % grid->grid_width) + grid->grid_width) % grid->grid_width;
+        y = ((y % grid->grid_height) + grid->grid_height) % grid->grid_height;
+        z = ((z % grid->grid_depth) + grid->grid_depth) % grid->grid_depth;
+    }
     if (x < 0 || x >= grid->grid_width ||
         y < 0 || y >= grid->grid_height ||
         z < 0 || z >= grid->grid_depth) {
@@ -12,46 +26,148 @@ static inline int get_cell_index(SpatialGrid* grid, int x, int y, int z) {
     return x + y * grid->grid_width + z * grid->grid_width * grid->grid_height;
 }
 
-static inline void get_grid_coords(SpatialGrid* grid, const Vector3D* pos,
+static inline void get_grid_coords(const SpatialGrid* grid, const Vector3D* pos,
                                    int* x_out, int* y_out, int* z_out) {
+    if (grid->hashed) {
+        // Unbounded world: floor so cells left of the origin don't alias cell 0.
+        *x_out = (int)floorf(pos->x / grid->cell_size);
+        *y_out = (int)floorf(pos->y / grid->cell_size);
+        *z_out = (int)floorf(pos->z / grid->cell_size);
+        return;
+    }
     *x_out = (int)(pos->x / grid->cell_size);
     *y_out = (int)(pos->y / grid->cell_size);
     *z_out = (int)(pos->z / grid->cell_size);
 }
 
-SpatialGrid* spatial_grid_create(float world_width, float world_height, float world_depth,
-                                  float cell_size, int max_particles) {
+static SpatialGrid* grid_alloc(float cell_size, int total_cells, int max_particles) {
     SpatialGrid* grid = malloc(sizeof(SpatialGrid));
 
     grid->cell_size = cell_size;
-    grid->grid_width = (int)ceilf(world_width / cell_size);
-    grid->grid_height = (int)ceilf(world_height / cell_size);
-    grid->grid_depth = (int)ceilf(world_depth / cell_size);
-    grid->total_cells = grid->grid_width * grid->grid_height * grid->grid_depth;
+    grid->total_cells = total_cells;
     grid->num_particles = max_particles;
+    grid->indexed_count = 0;
+    grid->hashed = 0;
+    grid->hash_mask = 0;
+    grid->periodic = 0;
+    grid->world_width = 0.0f;
+    grid->world_height = 0.0f;
+    grid->world_depth = 0.0f;
 
     grid->particle_indices = malloc(sizeof(int) * max_particles);
+    grid->particle_cells = malloc(sizeof(int) * max_particles);
+    grid->block_histograms = NULL;
+    grid->range_sums = NULL;
+    grid->num_blocks = 0;
     grid->cell_starts = malloc(sizeof(int) * grid->total_cells);
     grid->cell_counts = malloc(sizeof(int) * grid->total_cells);
+    grid->cell_sums = NULL;
+    grid->summary_groups = 0;
+
+    return grid;
+}
+
+SpatialGrid* spatial_grid_create(float world_width, float world_height, float world_depth,
+                                  float cell_size, int max_particles) {
+    int grid_width = (int)ceilf(world_width / cell_size);
+    int grid_height = (int)ceilf(world_height / cell_size);
+    int grid_depth = (int)ceilf(world_depth / cell_size);
+
+    SpatialGrid* grid = grid_alloc(cell_size, grid_width * grid_height * grid_depth, max_particles);
+    grid->grid_width = grid_width;
+    grid->grid_height = grid_height;
+    grid->grid_depth = grid_depth;
+    grid->world_width = world_width;
+    grid->world_height = world_height;
+    grid->world_depth = world_depth;
+
+    return grid;
+}
+
+void spatial_grid_set_periodic(SpatialGrid* grid, int periodic) {
+    grid->periodic = periodic && !grid->hashed;
+}
+
+int spatial_grid_set_summaries(SpatialGrid* grid, int groups) {
+    if (groups > MAX_FLOCK_GROUPS) groups = MAX_FLOCK_GROUPS;
+    int status = 0;
+    if (groups > 0 && grid->hashed) {
+        groups = 0;
+        status = -1;
+    }
+    if (groups == grid->summary_groups) return status;
+
+    free(grid->cell_sums);
+    grid->cell_sums = NULL;
+    grid->summary_groups = groups;
+    if (groups > 0) {
+        grid->cell_sums = calloc((size_t)grid->total_cells * groups * SUMMARY_FLOATS,
+                                 sizeof(float));
+        if (!grid->cell_sums) {
+            grid->summary_groups = 0;
+            status = -1;
+        }
+    }
+    return status;
+}
+
+SpatialGrid* spatial_grid_create_hashed(float cell_size, int max_particles, int table_size) {
+    if (table_size <= 0) table_size = 2 * max_particles;
+
+    int buckets = 1;
+    while (buckets < table_size) buckets <<= 1;
+
+    SpatialGrid* grid = grid_alloc(cell_size, buckets, max_particles);
+    grid->grid_width = 0;
+    grid->grid_height = 0;
+    grid->grid_depth = 0;
+    grid->hashed = 1;
+    grid->hash_mask = (unsigned)buckets - 1;
 
     return grid;
 }
 
 void spatial_grid_destroy(SpatialGrid* grid) {
     free(grid->particle_indices);
+    free(grid->particle_cells);
+    free(grid->block_histograms);
+    free(grid->range_sums);
     free(grid->cell_starts);
     free(grid->cell_counts);
+    free(grid->cell_sums);
     free(grid);
 }
 
-void spatial_grid_update(SpatialGrid* grid, Particle* particles, int count) {
+size_t spatial_grid_bytes(const SpatialGrid* grid) {
+    size_t cells = (size_t)grid->total_cells;
+    size_t bytes = sizeof(SpatialGrid) + 2 * sizeof(int) * (size_t)grid->num_particles +
+                   2 * sizeof(int) * cells;
+    if (grid->block_histograms) {
+        bytes += sizeof(int) * (size_t)grid->num_blocks * (cells + 1);
+    }
+    if (grid->cell_sums) {
+        bytes += sizeof(float) * cells * grid->summary_groups * SUMMARY_FLOATS;
+    }
+    return bytes;
+}
+
+static inline int cell_of(const SpatialGrid* grid, float x, float y, float z) {
+    Vector3D pos = vec3_create(x, y, z);
+    int gx, gy, gz;
+    get_grid_coords(grid, &pos, &gx, &gy, &gz);
+    return get_cell_index(grid, gx, gy, gz);
+}
+
+// Both the AoS and SoA entry points funnel into these: positions are read as
+// px[i * stride], so a Particle array is just a strided view of its fields.
+static void grid_build(SpatialGrid* grid, const float* px, const float* py,
+                       const float* pz, int stride, int count) {
     memset(grid->cell_counts, 0, sizeof(int) * grid->total_cells);
     memset(grid->cell_starts, -1, sizeof(int) * grid->total_cells);
 
     for (int i = 0; i < count; i++) {
-        int gx, gy, gz;
-        get_grid_coords(grid, &particles[i].position, &gx, &gy, &gz);
-        int cell_idx = get_cell_index(grid, gx, gy, gz);
+        int cell_idx = cell_of(grid, px[i * stride], py[i * stride], pz[i * stride]);
+        grid->particle_cells[i] = cell_idx;
 
         if (cell_idx >= 0) {
             grid->cell_counts[cell_idx]++;
@@ -65,13 +181,12 @@ void spatial_grid_update(SpatialGrid* grid, Particle* particles, int count) {
             offset += grid->cell_counts[i];
         }
     }
+    grid->indexed_count = offset;
 
     memset(grid->cell_counts, 0, sizeof(int) * grid->total_cells);
 
     for (int i = 0; i < count; i++) {
-        int gx, gy, gz;
-        get_grid_coords(grid, &particles[i].position, &gx, &gy, &gz);
-        int cell_idx = get_cell_index(grid, gx, gy, gz);
+        int cell_idx = grid->particle_cells[i];
 
         if (cell_idx >= 0) {
             int idx = grid->cell_starts[cell_idx] + grid->cell_counts[cell_idx];
@@ -81,24 +196,363 @@ void spatial_grid_update(SpatialGrid* grid, Particle* particles, int count) {
     }
 }
 
-void spatial_grid_query_neighbors(SpatialGrid* grid, Particle* particles,
-                                   const Vector3D* position, float radius,
-                                   int** neighbors_out, int* neighbor_count_out) {
-    static int neighbor_buffer[MAX_NEIGHBORS];
-    int neighbor_count = 0;
+// Parallel build. Particles are split into one contiguous block per pool
+// thread and cells into the same number of contiguous ranges; every stage is
+// a parallel_for over those blocks with chunk size 1, so the output matches
+// grid_build exactly regardless of which thread runs which block.
+typedef struct {
+    SpatialGrid* grid;
+    const float* px;
+    const float* py;
+    const float* pz;
+    const ParticleSoA* particles;
+    int count;
+    int num_blocks;
+    int* range_sums;
+} GridBuildTask;
+
+static inline int block_begin(int block, int num_blocks, int n) {
+    return (int)((long long)n * block / num_blocks);
+}
+
+static void build_histogram_block(void* ctx, int begin, int end, int thread_idx) {
+    (void)thread_idx;
+    const GridBuildTask* t = (const GridBuildTask*)ctx;
+    SpatialGrid* grid = t->grid;
+
+    for (int b = begin; b < end; b++) {
+        int* hist = grid->block_histograms + (size_t)b * grid->total_cells;
+        memset(hist, 0, sizeof(int) * grid->total_cells);
+
+        int first = block_begin(b, t->num_blocks, t->count);
+        int last = block_begin(b + 1, t->num_blocks, t->count);
+        for (int i = first; i < last; i++) {
+            int cell_idx = cell_of(grid, t->px[i], t->py[i], t->pz[i]);
+            grid->particle_cells[i] = cell_idx;
+            if (cell_idx >= 0) hist[cell_idx]++;
+        }
+    }
+}
+
+static void sum_cell_range(void* ctx, int begin, int end, int thread_idx) {
+    (void)thread_idx;
+    const GridBuildTask* t = (const GridBuildTask*)ctx;
+    const SpatialGrid* grid = t->grid;
+
+    for (int r = begin; r < end; r++) {
+        int first = block_begin(r, t->num_blocks, grid->total_cells);
+        int last = block_begin(r + 1, t->num_blocks, grid->total_cells);
+        int sum = 0;
+        for (int b = 0; b < t->num_blocks; b++) {
+            const int* hist = grid->block_histograms + (size_t)b * grid->total_cells;
+            for (int c = first; c < last; c++) sum += hist[c];
+        }
+        t->range_sums[r] = sum;
+    }
+}
+
+// Turns each block's histogram into that block's write cursor per cell and
+// fills cell_starts/cell_counts, starting from the range's scanned offset.
+static void scan_cell_range(void* ctx, int begin, int end, int thread_idx) {
+    (void)thread_idx;
+    const GridBuildTask* t = (const GridBuildTask*)ctx;
+    SpatialGrid* grid = t->grid;
+
+    for (int r = begin; r < end; r++) {
+        int first = block_begin(r, t->num_blocks, grid->total_cells);
+        int last = block_begin(r + 1, t->num_blocks, grid->total_cells);
+        int offset = t->range_sums[r];
+        for (int c = first; c < last; c++) {
+            int cell_start = offset;
+            for (int b = 0; b < t->num_blocks; b++) {
+                int* hist = grid->block_histograms + (size_t)b * grid->total_cells;
+                int n = hist[c];
+                hist[c] = offset;
+                offset += n;
+            }
+            grid->cell_counts[c] = offset - cell_start;
+            grid->cell_starts[c] = offset > cell_start ? cell_start : -1;
+        }
+    }
+}
+
+static void scatter_block(void* ctx, int begin, int end, int thread_idx) {
+    (void)thread_idx;
+    const GridBuildTask* t = (const GridBuildTask*)ctx;
+    SpatialGrid* grid = t->grid;
+
+    for (int b = begin; b < end; b++) {
+        int* cursor = grid->block_histograms + (size_t)b * grid->total_cells;
+        int first = block_begin(b, t->num_blocks, t->count);
+        int last = block_begin(b + 1, t->num_blocks, t->count);
+        for (int i = first; i < last; i++) {
+            int cell_idx = grid->particle_cells[i];
+            if (cell_idx >= 0) grid->particle_indices[cursor[cell_idx]++] = i;
+        }
+    }
+}
+
+// Sums each cell's members in particle_indices order, so the totals don't
+// depend on how cells are split between threads. Particles of groups past
+// summary_groups count towards the last one.
+static void summarize_cells(SpatialGrid* grid, const ParticleSoA* particles, int first,
+                            int last) {
+    int groups = grid->summary_groups;
+    for (int c = first; c < last; c++) {
+        int n = grid->cell_counts[c];
+        if (n == 0) continue;
+        const int* members = grid->particle_indices + grid->cell_starts[c];
+        float sums[MAX_FLOCK_GROUPS * SUMMARY_FLOATS] = {0};
+        for (int m = 0; m < n; m++) {
+            int i = members[m];
+            int g = particles->group[i] < groups ? particles->group[i] : groups - 1;
+            float* group_sums = sums + g * SUMMARY_FLOATS;
+            group_sums[0] += particles->x[i];
+            group_sums[1] += particles->y[i];
+            group_sums[2] += particles->z[i];
+            group_sums[3] += particles->vx[i];
+            group_sums[4] += particles->vy[i];
+            group_sums[5] += particles->vz[i];
+            group_sums[6] += 1.0f;
+        }
+        memcpy(grid->cell_sums + (size_t)c * groups * SUMMARY_FLOATS, sums,
+               sizeof(float) * groups * SUMMARY_FLOATS);
+    }
+}
+
+static void summarize_cell_range(void* ctx, int begin, int end, int thread_idx) {
+    (void)thread_idx;
+    const GridBuildTask* t = (const GridBuildTask*)ctx;
+    int total_cells = t->grid->total_cells;
+    for (int r = begin; r < end; r++) {
+        summarize_cells(t->grid, t->particles, block_begin(r, t->num_blocks, total_cells),
+                        block_begin(r + 1, t->num_blocks, total_cells));
+    }
+}
+
+void spatial_grid_update_soa_parallel(SpatialGrid* grid, const ParticleSoA* particles,
+                                      ThreadPool* pool) {
+    int num_blocks = thread_pool_size(pool);
+    if (num_blocks <= 1) {
+        spatial_grid_update_soa(grid, particles);
+        return;
+    }
+
+    if (grid->num_blocks != num_blocks) {
+        free(grid->block_histograms);
+        free(grid->range_sums);
+        grid->block_histograms = malloc(sizeof(int) * (size_t)num_blocks * grid->total_cells);
+        grid->range_sums = malloc(sizeof(int) * num_blocks);
+        grid->num_blocks = num_blocks;
+        if (!grid->block_histograms || !grid->range_sums) {
+            // Retried on the next update; the serial build needs neither.
+            free(grid->block_histograms);
+            free(grid->range_sums);
+            grid->block_histograms = NULL;
+            grid->range_sums = NULL;
+            grid->num_blocks = 0;
+        }
+    }
+    if (!grid->block_histograms) {
+        spatial_grid_update_soa(grid, particles);
+        return;
+    }
+
+    int* range_sums = grid->range_sums;
+    GridBuildTask task = {grid, particles->x, particles->y, particles->z, particles,
+                          particles->count, num_blocks, range_sums};
+
+    thread_pool_parallel_for(pool, num_blocks, 1, build_histogram_block, &task);
+    thread_pool_parallel_for(pool, num_blocks, 1, sum_cell_range, &task);
+
+    int offset = 0;
+    for (int r = 0; r < num_blocks; r++) {
+        int n = range_sums[r];
+        range_sums[r] = offset;
+        offset += n;
+    }
+    grid->indexed_count = offset;
+
+    thread_pool_parallel_for(pool, num_blocks, 1, scan_cell_range, &task);
+    thread_pool_parallel_for(pool, num_blocks, 1, scatter_block, &task);
+    if (grid->cell_sums) {
+        thread_pool_parallel_for(pool, num_blocks, 1, summarize_cell_range, &task);
+    }
+}
+
+// Squared distance from p to the slab [lo, lo + size] along one axis.
+static inline float slab_dist_sq(float p, float lo, float size) {
+    float d = 0.0f;
+    if (p < lo) d = lo - p;
+    else if (p > lo + size) d = p - (lo + size);
+    return d * d;
+}
+
+static inline float min_image(float d, float extent) {
+    if (d > extent * 0.5f) return d - extent;
+    if (d < -extent * 0.5f) return d + extent;
+    return d;
+}
+
+// Cell offsets [lo, hi] to scan on one axis, and whether cells may be culled
+// by their slab distance.
+typedef struct {
+    int lo;
+    int hi;
+    int cull;
+} AxisWindow;
+
+static inline AxisWindow axis_window(const SpatialGrid* grid, int cell_radius,
+                                     int dim, float extent) {
+    AxisWindow w = {-cell_radius, cell_radius, 1};
+    if (!grid->periodic) return w;
 
+    // A partial last cell shifts wrapped images by up to one cell.
+    if (dim * grid->cell_size > extent) {
+        w.lo--;
+        w.hi++;
+    }
+    // A window spanning the whole axis reaches cells through the seam as
+    // well as directly, so the direct slab no longer bounds the distance;
+    // cap it so no cell is visited twice.
+    if (w.hi - w.lo + 1 >= dim) {
+        w.hi = w.lo + dim - 1;
+        w.cull = 0;
+    }
+    return w;
+}
+
+// Cells past the edge of a periodic grid are images of the far side whose
+// slab can't bound the distance either; they are never culled.
+static inline float cell_dist_sq(const SpatialGrid* grid, const AxisWindow* w,
+                                 float p, int g, int dim) {
+    if (!w->cull || (grid->periodic && (g < 0 || g >= dim))) return 0.0f;
+    return slab_dist_sq(p, g * grid->cell_size, grid->cell_size);
+}
+
+// Where accepted candidates go. First-found mode fills out[] in scan order
+// and stops the scan when it is full. Nearest mode keeps out[]/heap_d[] as
+// a max-heap on (dist_sq, index) and tightens bound_sq to the current k-th
+// distance once it is full, so cells farther than that are culled.
+typedef struct {
+    int* out;
+    int max;
+    int count;
+    int nearest;
+    int exclude;
+    float bound_sq;
+    float heap_d[SPATIAL_GRID_MAX_K];
+} QueryCollector;
+
+static inline int heap_less(const QueryCollector* c, int a, int b) {
+    if (c->heap_d[a] != c->heap_d[b]) return c->heap_d[a] < c->heap_d[b];
+    return c->out[a] < c->out[b];
+}
+
+static inline void heap_swap(QueryCollector* c, int a, int b) {
+    float d = c->heap_d[a];
+    c->heap_d[a] = c->heap_d[b];
+    c->heap_d[b] = d;
+    int i = c->out[a];
+    c->out[a] = c->out[b];
+    c->out[b] = i;
+}
+
+static void heap_sift_down(QueryCollector* c, int i, int n) {
+    for (;;) {
+        int largest = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        if (l < n && heap_less(c, largest, l)) largest = l;
+        if (r < n && heap_less(c, largest, r)) largest = r;
+        if (largest == i) return;
+        heap_swap(c, i, largest);
+        i = largest;
+    }
+}
+
+static inline int collector_full(const QueryCollector* c) {
+    return !c->nearest && c->count >= c->max;
+}
+
+static inline void collect(QueryCollector* c, int particle_idx, float dist_sq) {
+    if (!c->nearest) {
+        c->out[c->count++] = particle_idx;
+        return;
+    }
+    if (particle_idx == c->exclude) return;
+
+    if (c->count < c->max) {
+        int i = c->count++;
+        c->out[i] = particle_idx;
+        c->heap_d[i] = dist_sq;
+        while (i > 0 && heap_less(c, (i - 1) / 2, i)) {
+            heap_swap(c, i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+    } else if (dist_sq < c->heap_d[0] ||
+               (dist_sq == c->heap_d[0] && particle_idx < c->out[0])) {
+        c->out[0] = particle_idx;
+        c->heap_d[0] = dist_sq;
+        heap_sift_down(c, 0, c->count);
+    } else {
+        return;
+    }
+
+    if (c->count == c->max) c->bound_sq = c->heap_d[0];
+}
+
+// Heap-sorts the k nearest into ascending (dist_sq, index) order.
+static void collector_finish(QueryCollector* c) {
+    if (!c->nearest) return;
+    for (int n = c->count - 1; n > 0; n--) {
+        heap_swap(c, 0, n);
+        heap_sift_down(c, 0, n);
+    }
+}
+
+// Cull test: a cell is skipped when nothing in it can be accepted. Nearest
+// mode keeps cells exactly at the bound, which may hold a lower-index tie.
+static inline int beyond_bound(const QueryCollector* c, float dist_sq) {
+    return c->nearest ? dist_sq > c->bound_sq : dist_sq >= c->bound_sq;
+}
+
+static void grid_query(const SpatialGrid* grid, const float* px, const float* py,
+                       const float* pz, int stride, const Vector3D* position,
+                       float radius, QueryCollector* c) {
     int cx, cy, cz;
     get_grid_coords(grid, position, &cx, &cy, &cz);
 
-    int cell_radius = 1;
+    // Enough cells to cover the sphere whatever the cell/radius ratio; with
+    // cells one radius wide this is the 27-cell neighbourhood.
+    float cs = grid->cell_size;
+    int cell_radius = (int)ceilf(radius / cs);
+    if (cell_radius < 1) cell_radius = 1;
     float radius_sq = radius * radius;
+    c->bound_sq = radius_sq;
+
+    AxisWindow wx = axis_window(grid, cell_radius, grid->grid_width, grid->world_width);
+    AxisWindow wy = axis_window(grid, cell_radius, grid->grid_height, grid->world_height);
+    AxisWindow wz = axis_window(grid, cell_radius, grid->grid_depth, grid->world_depth);
+    long cells = 0;
+    long candidates = 0;
 
-    for (int dz = -cell_radius; dz <= cell_radius && neighbor_count < MAX_NEIGHBORS; dz++) {
-        for (int dy = -cell_radius; dy <= cell_radius && neighbor_count < MAX_NEIGHBORS; dy++) {
-            for (int dx = -cell_radius; dx <= cell_radius && neighbor_count < MAX_NEIGHBORS; dx++) {
+    for (int dz = wz.lo; dz <= wz.hi && !collector_full(c); dz++) {
+        int gz = cz + dz;
+        float dist_z = cell_dist_sq(grid, &wz, position->z, gz, grid->grid_depth);
+        if (beyond_bound(c, dist_z)) continue;
+
+        for (int dy = wy.lo; dy <= wy.hi && !collector_full(c); dy++) {
+            int gy = cy + dy;
+            float dist_yz = dist_z + cell_dist_sq(grid, &wy, position->y, gy, grid->grid_height);
+            if (beyond_bound(c, dist_yz)) continue;
+
+            for (int dx = wx.lo; dx <= wx.hi && !collector_full(c); dx++) {
                 int gx = cx + dx;
-                int gy = cy + dy;
-                int gz = cz + dz;
+                if (beyond_bound(c, dist_yz + cell_dist_sq(grid, &wx, position->x, gx,
+                                                           grid->grid_width))) {
+                    continue;
+                }
 
                 int cell_idx = get_cell_index(grid, gx, gy, gz);
                 if (cell_idx < 0) continue;
@@ -107,19 +561,226 @@ void spatial_grid_query_neighbors(SpatialGrid* grid, Particle* particles,
                 int count = grid->cell_counts[cell_idx];
 
                 if (start < 0) continue;
+                cells++;
 
-                for (int i = 0; i < count && neighbor_count < MAX_NEIGHBORS; i++) {
+                for (int i = 0; i < count && !collector_full(c); i++) {
+                    candidates++;
                     int particle_idx = grid->particle_indices[start + i];
-                    float dist_sq = vec3_dist_sq_inline(position, &particles[particle_idx].position);
+                    int o = particle_idx * stride;
+                    float ddx = position->x - px[o];
+                    float ddy = position->y - py[o];
+                    float ddz = position->z - pz[o];
+                    if (grid->periodic) {
+                        ddx = min_image(ddx, grid->world_width);
+                        ddy = min_image(ddy, grid->world_height);
+                        ddz = min_image(ddz, grid->world_depth);
+                    }
+                    float dist_sq = ddx * ddx + ddy * ddy + ddz * ddz;
+
+                    if (dist_sq >= radius_sq) continue;
 
-                    if (dist_sq < radius_sq) {
-                        neighbor_buffer[neighbor_count++] = particle_idx;
+                    if (grid->hashed) {
+                        // A bucket can hold several cells; only take the
+                        // particle from its own cell so it is reported once.
+                        Vector3D p = vec3_create(px[o], py[o], pz[o]);
+                        int hx, hy, hz;
+                        get_grid_coords(grid, &p, &hx, &hy, &hz);
+                        if (hx != gx || hy != gy || hz != gz) continue;
                     }
+
+                    collect(c, particle_idx, dist_sq);
                 }
             }
         }
     }
 
+    collector_finish(c);
+    trace_count(TRACE_CELLS, cells);
+    trace_count(TRACE_CANDIDATES, candidates);
+}
+
+static int query_first_found(const SpatialGrid* grid, const float* px, const float* py,
+                             const float* pz, int stride, const Vector3D* position,
+                             float radius, int* neighbors_out, int max_neighbors) {
+    QueryCollector c;
+    c.out = neighbors_out;
+    c.max = max_neighbors;
+    c.count = 0;
+    c.nearest = 0;
+    c.exclude = -1;
+    grid_query(grid, px, py, pz, stride, position, radius, &c);
+    return c.count;
+}
+
+static int query_nearest(const SpatialGrid* grid, const float* px, const float* py,
+                         const float* pz, int stride, const Vector3D* position,
+                         float radius, int exclude_idx, int* neighbors_out, int k) {
+    if (k > SPATIAL_GRID_MAX_K) k = SPATIAL_GRID_MAX_K;
+    if (k <= 0) return 0;
+
+    QueryCollector c;
+    c.out = neighbors_out;
+    c.max = k;
+    c.count = 0;
+    c.nearest = 1;
+    c.exclude = exclude_idx;
+    grid_query(grid, px, py, pz, stride, position, radius, &c);
+    return c.count;
+}
+
+#define PARTICLE_STRIDE ((int)(sizeof(Particle) / sizeof(float)))
+
+void spatial_grid_update(SpatialGrid* grid, Particle* particles, int count) {
+    grid_build(grid, &particles->position.x, &particles->position.y,
+               &particles->position.z, PARTICLE_STRIDE, count);
+}
+
+void spatial_grid_update_soa(SpatialGrid* grid, const ParticleSoA* particles) {
+    grid_build(grid, particles->x, particles->y, particles->z, 1, particles->count);
+    if (grid->cell_sums) summarize_cells(grid, particles, 0, grid->total_cells);
+}
+
+void spatial_grid_query_neighbors(SpatialGrid* grid, Particle* particles,
+                                   const Vector3D* position, float radius,
+                                   int** neighbors_out, int* neighbor_count_out) {
+    static int neighbor_buffer[MAX_NEIGHBORS];
+
+    *neighbor_count_out = spatial_grid_query_neighbors_into(grid, particles, position, radius,
+                                                            neighbor_buffer, MAX_NEIGHBORS);
+    *neighbors_out = neighbor_buffer;
+}
+
+void spatial_grid_query_neighbors_soa(SpatialGrid* grid, const ParticleSoA* particles,
+                                       const Vector3D* position, float radius,
+                                       int** neighbors_out, int* neighbor_count_out) {
+    static int neighbor_buffer[MAX_NEIGHBORS];
+
+    *neighbor_count_out = spatial_grid_query_neighbors_soa_into(grid, particles, position, radius,
+                                                                neighbor_buffer, MAX_NEIGHBORS);
     *neighbors_out = neighbor_buffer;
-    *neighbor_count_out = neighbor_count;
+}
+
+void spatial_grid_reorder_soa(SpatialGrid* grid, ParticleSoA* particles) {
+    int placed = grid->indexed_count;
+    int* order = particles->order;
+
+    // The scatter pass already left particle_indices in cell order; anything
+    // that fell outside the grid keeps its relative order at the tail.
+    for (int i = 0; i < particles->count; i++) {
+        particles->remap[i] = -1;
+    }
+    for (int k = 0; k < placed; k++) {
+        order[k] = grid->particle_indices[k];
+        particles->remap[order[k]] = k;
+    }
+    int next = placed;
+    for (int i = 0; i < particles->count; i++) {
+        if (particles->remap[i] < 0) order[next++] = i;
+    }
+
+    particle_soa_permute(particles, order);
+
+    for (int k = 0; k < placed; k++) {
+        grid->particle_indices[k] = k;
+    }
+}
+
+// Cell offsets [lo, hi] to visit along one axis. A periodic axis under
+// three cells wide would otherwise see a cell twice.
+static inline void field_window(const SpatialGrid* grid, int cells, int* lo, int* hi) {
+    if (grid->periodic && cells < 3) {
+        *lo = 0;
+        *hi = cells - 1;
+    } else {
+        *lo = -1;
+        *hi = 1;
+    }
+}
+
+int spatial_grid_cell_field(const SpatialGrid* grid, const Vector3D* position, int group,
+                            float radius, Vector3D* offset_sum, Vector3D* velocity_sum) {
+    int groups = grid->summary_groups;
+    if (group >= groups) group = groups - 1;
+    float radius_sq = radius * radius;
+    int gx, gy, gz;
+    get_grid_coords(grid, position, &gx, &gy, &gz);
+    int x_lo, x_hi, y_lo, y_hi, z_lo, z_hi;
+    field_window(grid, grid->grid_width, &x_lo, &x_hi);
+    field_window(grid, grid->grid_height, &y_lo, &y_hi);
+    field_window(grid, grid->grid_depth, &z_lo, &z_hi);
+
+    float offset[3] = {0.0f, 0.0f, 0.0f};
+    float velocity[3] = {0.0f, 0.0f, 0.0f};
+    int total = 0;
+    for (int dz = z_lo; dz <= z_hi; dz++) {
+        for (int dy = y_lo; dy <= y_hi; dy++) {
+            for (int dx = x_lo; dx <= x_hi; dx++) {
+                int cell_idx = get_cell_index(grid, gx + dx, gy + dy, gz + dz);
+                if (cell_idx < 0 || grid->cell_counts[cell_idx] == 0) continue;
+                const float* sums =
+                    grid->cell_sums + ((size_t)cell_idx * groups + group) * SUMMARY_FLOATS;
+                int n = (int)sums[6];
+                if (n == 0) continue;
+
+                // A cell never straddles the wrap, so its centroid's
+                // nearest image stands in for all of its members.
+                float inv_n = 1.0f / (float)n;
+                float cx = sums[0] * inv_n - position->x;
+                float cy = sums[1] * inv_n - position->y;
+                float cz = sums[2] * inv_n - position->z;
+                if (grid->periodic) {
+                    cx = min_image(cx, grid->world_width);
+                    cy = min_image(cy, grid->world_height);
+                    cz = min_image(cz, grid->world_depth);
+                }
+                bool home = dx == 0 && dy == 0 && dz == 0;
+                if (!home && cx * cx + cy * cy + cz * cz > radius_sq) continue;
+                offset[0] += cx * n;
+                offset[1] += cy * n;
+                offset[2] += cz * n;
+                velocity[0] += sums[3];
+                velocity[1] += sums[4];
+                velocity[2] += sums[5];
+                total += n;
+            }
+        }
+    }
+    *offset_sum = vec3_create(offset[0], offset[1], offset[2]);
+    *velocity_sum = vec3_create(velocity[0], velocity[1], velocity[2]);
+    return total;
+}
+
+int spatial_grid_cell_population(const SpatialGrid* grid, float x, float y, float z) {
+    int cell_idx = cell_of(grid, x, y, z);
+    return cell_idx >= 0 ? grid->cell_counts[cell_idx] : 0;
+}
+
+int spatial_grid_query_neighbors_into(const SpatialGrid* grid, const Particle* particles,
+                                      const Vector3D* position, float radius,
+                                      int* neighbors_out, int max_neighbors) {
+    return query_first_found(grid, &particles->position.x, &particles->position.y,
+                             &particles->position.z, PARTICLE_STRIDE,
+                             position, radius, neighbors_out, max_neighbors);
+}
+
+int spatial_grid_query_neighbors_soa_into(const SpatialGrid* grid, const ParticleSoA* particles,
+                                          const Vector3D* position, float radius,
+                                          int* neighbors_out, int max_neighbors) {
+    return query_first_found(grid, particles->x, particles->y, particles->z, 1,
+                             position, radius, neighbors_out, max_neighbors);
+}
+
+int spatial_grid_query_nearest_into(const SpatialGrid* grid, const Particle* particles,
+                                    const Vector3D* position, float radius, int exclude_idx,
+                                    int* neighbors_out, int k) {
+    return query_nearest(grid, &particles->position.x, &particles->position.y,
+                         &particles->position.z, PARTICLE_STRIDE,
+                         position, radius, exclude_idx, neighbors_out, k);
+}
+
+int spatial_grid_query_nearest_soa_into(const SpatialGrid* grid, const ParticleSoA* particles,
+                                        const Vector3D* position, float radius, int exclude_idx,
+                                        int* neighbors_out, int k) {
+    return query_nearest(grid, particles->x, particles->y, particles->z, 1,
+                         position, radius, exclude_idx, neighbors_out, k);
 }
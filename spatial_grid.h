@@ -1,30 +1,114 @@
 #ifndef SPATIAL_GRID_H
 #define SPATIAL_GRID_H
 
+#include <stddef.h>
 #include "particle.h"
+#include "particle_soa.h"
+#include "thread_pool.h"
 
 #define MAX_PARTICLES_PER_CELL 64
 #define MAX_NEIGHBORS 10
+#define SPATIAL_GRID_MAX_K 64
 
 typedef struct {
   int *particle_indices;
   int *cell_starts;
   int *cell_counts;
+  int *particle_cells;   // cell of each particle from the last build, -1 if outside
+  int *block_histograms; // num_blocks x total_cells, parallel build scratch
+  int *range_sums;
+  int num_blocks;
   int grid_width;
   int grid_height;
   int grid_depth;
   float cell_size;
   int total_cells;
   int num_particles;
+  int indexed_count;
+  // Hashed grids map cell coordinates into total_cells buckets instead of a
+  // dense width x height x depth array, so memory tracks particle count.
+  int hashed;
+  unsigned hash_mask;
+  // Periodic grids wrap cell coordinates and measure minimum-image
+  // distances, matching particle_wrap. Dense grids only.
+  int periodic;
+  float world_width;
+  float world_height;
+  float world_depth;
+  // Per-cell, per-group position and velocity sums and member counts (7
+  // floats a group, summary_groups a cell) from the last SoA update, while
+  // summaries are on.
+  float *cell_sums;
+  int summary_groups;
 } SpatialGrid;
 
 SpatialGrid *spatial_grid_create(float world_width, float world_height,
                                  float world_depth, float cell_size,
                                  int max_particles);
+// Unbounded spatial hash with the same update/query behaviour. table_size is
+// rounded up to a power of two; <= 0 picks 2 x max_particles buckets.
+SpatialGrid *spatial_grid_create_hashed(float cell_size, int max_particles,
+                                        int table_size);
 void spatial_grid_destroy(SpatialGrid *grid);
+// Heap bytes the grid holds, parallel build scratch and summaries included.
+size_t spatial_grid_bytes(const SpatialGrid *grid);
+void spatial_grid_set_periodic(SpatialGrid *grid, int periodic);
+// Has the SoA updates also sum position and velocity per cell for each of
+// the first groups flock groups, for spatial_grid_cell_field; 0 turns it
+// off, the default. Returns -1 on hashed grids, whose buckets mix cells, or
+// if the sums can't be allocated, and leaves summaries off.
+int spatial_grid_set_summaries(SpatialGrid *grid, int groups);
 void spatial_grid_update(SpatialGrid *grid, Particle *particles, int count);
+void spatial_grid_update_soa(SpatialGrid *grid, const ParticleSoA *particles);
+// Same result as spatial_grid_update_soa, built with per-thread histograms,
+// a parallel prefix scan over cell ranges and a parallel scatter. Falls back
+// to the serial build while the histograms can't be allocated.
+void spatial_grid_update_soa_parallel(SpatialGrid *grid, const ParticleSoA *particles,
+                                      ThreadPool *pool);
+// Physically permutes the store into cell order using the last update's
+// counting sort, then rewrites particle_indices as the identity so the grid
+// stays valid without a rebuild. Any slot indices held by the caller must be
+// translated through particles->remap.
+void spatial_grid_reorder_soa(SpatialGrid *grid, ParticleSoA *particles);
+// Particles in the cell holding (x, y, z) at the last update, 0 outside the
+// grid. Reentrant.
+int spatial_grid_cell_population(const SpatialGrid *grid, float x, float y, float z);
+// Mean field of one flock group around position from the cell summaries:
+// the group's particles in its cell and in those of the 26 around it where
+// their centroid is within radius (as of the last update), their summed
+// velocity and their summed offset from position (minimum image when
+// periodic). Returns the count; needs summaries on. Reentrant.
+int spatial_grid_cell_field(const SpatialGrid *grid, const Vector3D *position, int group,
+                            float radius, Vector3D *offset_sum, Vector3D *velocity_sum);
+// These return a pointer into a shared static buffer: single-threaded only.
 void spatial_grid_query_neighbors(SpatialGrid *grid, Particle *particles,
                                   const Vector3D *position, float radius,
                                   int **neighbors_out, int *neighbor_count_out);
+void spatial_grid_query_neighbors_soa(SpatialGrid *grid, const ParticleSoA *particles,
+                                      const Vector3D *position, float radius,
+                                      int **neighbors_out, int *neighbor_count_out);
+
+// Reentrant variants: write up to max_neighbors indices into the caller's
+// buffer and return how many were found. Safe to call from worker threads.
+int spatial_grid_query_neighbors_into(const SpatialGrid *grid, const Particle *particles,
+                                      const Vector3D *position, float radius,
+                                      int *neighbors_out, int max_neighbors);
+int spatial_grid_query_neighbors_soa_into(const SpatialGrid *grid,
+                                          const ParticleSoA *particles,
+                                          const Vector3D *position, float radius,
+                                          int *neighbors_out, int max_neighbors);
+
+// Bounded k-nearest selection: the (up to) k particles closest to position
+// within radius, nearest first, ties broken by lower index, so the result
+// does not depend on cell traversal or in-cell order. exclude_idx (usually
+// the querying particle, or -1) is never returned. k is clamped to
+// SPATIAL_GRID_MAX_K.
+int spatial_grid_query_nearest_into(const SpatialGrid *grid, const Particle *particles,
+                                    const Vector3D *position, float radius, int exclude_idx,
+                                    int *neighbors_out, int k);
+int spatial_grid_query_nearest_soa_into(const SpatialGrid *grid,
+                                        const ParticleSoA *particles,
+                                        const Vector3D *position, float radius,
+                                        int exclude_idx, int *neighbors_out, int k);
 
 #endif
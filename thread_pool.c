@@ -0,0 +1,187 @@
+#define _POSIX_C_SOURCE 200809L
+#include "thread_pool.h"
+#include "trace.h"
+#include <stdlib.h>
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define THREAD_POOL_SERIAL 1
+#else
+#define THREAD_POOL_SERIAL 0
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#endif
+
+#if THREAD_POOL_SERIAL
+
+struct ThreadPool {
+    int num_threads;
+};
+
+ThreadPool* thread_pool_create(int num_threads) {
+    (void)num_threads;
+    ThreadPool* pool = malloc(sizeof(ThreadPool));
+    pool->num_threads = 1;
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool* pool) {
+    free(pool);
+}
+
+int thread_pool_default_size(void) {
+    return 1;
+}
+
+void thread_pool_parallel_for(ThreadPool* pool, int count, int chunk_size,
+                              ThreadPoolTask task, void* ctx) {
+    (void)pool;
+    (void)chunk_size;
+    if (count > 0) task(ctx, 0, count, 0);
+}
+
+#else
+
+typedef struct {
+    ThreadPool* pool;
+    int thread_idx;
+} WorkerArgs;
+
+struct ThreadPool {
+    int num_threads;
+    pthread_t* threads;
+    WorkerArgs* args;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    unsigned generation;
+    int active_workers;
+    int shutdown;
+
+    ThreadPoolTask task;
+    void* ctx;
+    int count;
+    int chunk_size;
+    atomic_int next_chunk;
+};
+
+static void run_chunks(ThreadPool* pool, int thread_idx) {
+    for (;;) {
+        int begin = atomic_fetch_add(&pool->next_chunk, pool->chunk_size);
+        if (begin >= pool->count) break;
+        int end = begin + pool->chunk_size;
+        if (end > pool->count) end = pool->count;
+        pool->task(pool->ctx, begin, end, thread_idx);
+    }
+}
+
+static void* worker_main(void* arg) {
+    WorkerArgs* args = (WorkerArgs*)arg;
+    ThreadPool* pool = args->pool;
+    unsigned seen_generation = 0;
+    trace_set_thread_name("worker");
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen_generation) {
+            pthread_cond_wait(&pool->work_ready, &pool->mutex);
+        }
+        if (pool->shutdown) break;
+        seen_generation = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        run_chunks(pool, args->thread_idx);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->active_workers == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+int thread_pool_default_size(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+}
+
+ThreadPool* thread_pool_create(int num_threads) {
+    ThreadPool* pool = calloc(1, sizeof(ThreadPool));
+
+    pool->num_threads = num_threads > 0 ? num_threads : thread_pool_default_size();
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+    atomic_init(&pool->next_chunk, 0);
+
+    // Thread 0 is the caller; only the extra workers get their own pthread.
+    int workers = pool->num_threads - 1;
+    pool->threads = malloc(sizeof(pthread_t) * (workers > 0 ? workers : 1));
+    pool->args = malloc(sizeof(WorkerArgs) * (workers > 0 ? workers : 1));
+    for (int i = 0; i < workers; i++) {
+        pool->args[i].pool = pool;
+        pool->args[i].thread_idx = i + 1;
+        if (pthread_create(&pool->threads[i], NULL, worker_main, &pool->args[i]) != 0) {
+            pool->num_threads = i + 1;
+            break;
+        }
+    }
+
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->num_threads - 1; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->threads);
+    free(pool->args);
+    free(pool);
+}
+
+void thread_pool_parallel_for(ThreadPool* pool, int count, int chunk_size,
+                              ThreadPoolTask task, void* ctx) {
+    if (count <= 0) return;
+    if (chunk_size <= 0) chunk_size = 1;
+
+    if (pool->num_threads == 1 || count <= chunk_size) {
+        task(ctx, 0, count, 0);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->task = task;
+    pool->ctx = ctx;
+    pool->count = count;
+    pool->chunk_size = chunk_size;
+    atomic_store(&pool->next_chunk, 0);
+    pool->active_workers = pool->num_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->mutex);
+
+    run_chunks(pool, 0);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->active_workers > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+#endif
+
+int thread_pool_size(const ThreadPool* pool) {
+    return pool->num_threads;
+}
@@ -0,0 +1,23 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// Runs a range [begin, end) on one thread. thread_idx is in [0, pool size)
+// and is stable for the duration of the call, so it can index per-thread
+// scratch buffers.
+typedef void (*ThreadPoolTask)(void *ctx, int begin, int end, int thread_idx);
+
+typedef struct ThreadPool ThreadPool;
+
+// num_threads <= 0 picks one thread per online core. The calling thread
+// counts as one of them, so a pool of size 1 spawns nothing and runs inline.
+ThreadPool *thread_pool_create(int num_threads);
+void thread_pool_destroy(ThreadPool *pool);
+int thread_pool_size(const ThreadPool *pool);
+int thread_pool_default_size(void);
+
+// Splits [0, count) into chunk_size pieces handed out dynamically, and
+// returns once every chunk has finished.
+void thread_pool_parallel_for(ThreadPool *pool, int count, int chunk_size,
+                              ThreadPoolTask task, void *ctx);
+
+#endif
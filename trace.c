@@ -0,0 +1,233 @@
+#define _POSIX_C_SOURCE 200809L
+#include "trace.h"
+
+#if TRACE_ENABLED
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+#define TRACE_MAX_THREADS 256
+#define TRACE_RING_EVENTS 16384
+#define TRACE_RING_SAMPLES 4096
+#define TRACE_MAX_DEPTH 16
+
+typedef struct {
+    const char* name;
+    double start;  // microseconds
+    double duration;
+} TraceEvent;
+
+typedef struct {
+    double time;
+    long values[TRACE_COUNTER_COUNT];
+} TraceSample;
+
+typedef struct {
+    int tid;
+    const char* thread_name;
+
+    TraceEvent events[TRACE_RING_EVENTS];
+    long event_total;  // ever recorded; the ring keeps the newest
+    TraceSample samples[TRACE_RING_SAMPLES];
+    long sample_total;
+
+    // Open spans. A span opened while tracing was off is kept with a
+    // negative start so nesting stays balanced when it is switched on.
+    const char* open_names[TRACE_MAX_DEPTH];
+    double open_starts[TRACE_MAX_DEPTH];
+    int depth;
+    int overflow;  // spans begun past TRACE_MAX_DEPTH, ended without popping
+
+    atomic_long counters[TRACE_COUNTER_COUNT];
+} TraceRing;
+
+static atomic_int enabled;
+static _Atomic(TraceRing*) rings[TRACE_MAX_THREADS];  // NULL until filled in
+static atomic_int ring_count;
+static _Thread_local TraceRing* local_ring;
+static _Thread_local const char* local_name;
+
+static const char* counter_names[TRACE_COUNTER_COUNT] = {"candidates", "cells", "cache_hits"};
+
+// Microseconds. Under emscripten this is performance.now(), so spans line
+// up with the browser's own timeline.
+static double now_us(void) {
+#ifdef __EMSCRIPTEN__
+    return emscripten_get_now() * 1000.0;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+#endif
+}
+
+// Rings are created on a thread's first traced call and outlive it, so a
+// trace can still be written once the workers are gone.
+static TraceRing* get_ring(void) {
+    if (local_ring) return local_ring;
+    int slot = atomic_fetch_add(&ring_count, 1);
+    if (slot >= TRACE_MAX_THREADS) {
+        atomic_fetch_sub(&ring_count, 1);
+        return NULL;
+    }
+    TraceRing* ring = calloc(1, sizeof(TraceRing));
+    if (!ring) {
+        // Leave the slot empty rather than shuffling the table.
+        return NULL;
+    }
+    ring->tid = slot + 1;
+    ring->thread_name = local_name;
+    for (int c = 0; c < TRACE_COUNTER_COUNT; c++) {
+        atomic_init(&ring->counters[c], 0);
+    }
+    atomic_store(&rings[slot], ring);
+    local_ring = ring;
+    return ring;
+}
+
+void trace_set_enabled(int on) {
+    atomic_store(&enabled, on ? 1 : 0);
+}
+
+int trace_is_enabled(void) {
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+void trace_begin(const char* name) {
+    TraceRing* ring = local_ring;
+    if (!trace_is_enabled()) {
+        // Only threads that already have a ring have spans to keep balanced.
+        if (ring && ring->depth < TRACE_MAX_DEPTH) {
+            ring->open_names[ring->depth] = name;
+            ring->open_starts[ring->depth] = -1.0;
+            ring->depth++;
+        } else if (ring) {
+            ring->overflow++;
+        }
+        return;
+    }
+    if (!ring) ring = get_ring();
+    if (!ring) return;
+    if (ring->depth >= TRACE_MAX_DEPTH) {
+        ring->overflow++;
+        return;
+    }
+    ring->open_names[ring->depth] = name;
+    ring->open_starts[ring->depth] = now_us();
+    ring->depth++;
+}
+
+void trace_end(void) {
+    TraceRing* ring = local_ring;
+    if (!ring || ring->depth == 0) return;
+    if (ring->overflow > 0) {
+        ring->overflow--;
+        return;
+    }
+    ring->depth--;
+    double start = ring->open_starts[ring->depth];
+    if (start < 0.0 || !trace_is_enabled()) return;
+
+    double end = now_us();
+    TraceEvent* event = &ring->events[ring->event_total % TRACE_RING_EVENTS];
+    event->name = ring->open_names[ring->depth];
+    event->start = start;
+    event->duration = end - start;
+    ring->event_total++;
+#ifdef __EMSCRIPTEN__
+    EM_ASM({ performance.measure(UTF8ToString($0), {start : $1, end : $2}); },
+           event->name, start / 1000.0, end / 1000.0);
+#endif
+}
+
+void trace_count(TraceCounter counter, long n) {
+    if (!trace_is_enabled() || n == 0) return;
+    TraceRing* ring = get_ring();
+    if (ring) atomic_fetch_add_explicit(&ring->counters[counter], n, memory_order_relaxed);
+}
+
+void trace_flush_counters(void) {
+    if (!trace_is_enabled()) return;
+    TraceRing* ring = get_ring();
+    if (!ring) return;
+
+    TraceSample* sample = &ring->samples[ring->sample_total % TRACE_RING_SAMPLES];
+    sample->time = now_us();
+    for (int c = 0; c < TRACE_COUNTER_COUNT; c++) {
+        sample->values[c] = 0;
+    }
+    int count = atomic_load(&ring_count);
+    for (int r = 0; r < count; r++) {
+        TraceRing* other = atomic_load(&rings[r]);
+        if (!other) continue;
+        for (int c = 0; c < TRACE_COUNTER_COUNT; c++) {
+            sample->values[c] += atomic_exchange_explicit(&other->counters[c], 0,
+                                                          memory_order_relaxed);
+        }
+    }
+    ring->sample_total++;
+#ifdef __EMSCRIPTEN__
+    EM_ASM({
+        performance.mark("flock counters",
+                         {startTime : $0, detail : {candidates : $1, cells : $2, cache_hits : $3}});
+    }, sample->time / 1000.0, (double)sample->values[TRACE_CANDIDATES],
+       (double)sample->values[TRACE_CELLS], (double)sample->values[TRACE_CACHE_HITS]);
+#endif
+}
+
+// Naming a thread doesn't allocate its ring; that waits for tracing.
+void trace_set_thread_name(const char* name) {
+    local_name = name;
+    if (local_ring) local_ring->thread_name = name;
+}
+
+// Oldest first; a full ring starts at the slot the next write would take.
+static long ring_first(long total, long capacity) {
+    return total > capacity ? total - capacity : 0;
+}
+
+int trace_write_chrome_json(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) return -1;
+
+    fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    const char* sep = "";
+    int count = atomic_load(&ring_count);
+    for (int r = 0; r < count; r++) {
+        const TraceRing* ring = atomic_load(&rings[r]);
+        if (!ring) continue;
+        fprintf(f, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                   "\"args\": {\"name\": \"%s\"}}",
+                sep, ring->tid, ring->thread_name ? ring->thread_name : "thread");
+        sep = ",\n";
+
+        for (long i = ring_first(ring->event_total, TRACE_RING_EVENTS); i < ring->event_total;
+             i++) {
+            const TraceEvent* event = &ring->events[i % TRACE_RING_EVENTS];
+            fprintf(f, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                       "\"ts\": %.3f, \"dur\": %.3f}",
+                    sep, event->name, ring->tid, event->start, event->duration);
+        }
+        for (long i = ring_first(ring->sample_total, TRACE_RING_SAMPLES); i < ring->sample_total;
+             i++) {
+            const TraceSample* sample = &ring->samples[i % TRACE_RING_SAMPLES];
+            fprintf(f, "%s{\"name\": \"neighbors\", \"ph\": \"C\", \"pid\": 1, \"tid\": %d, "
+                       "\"ts\": %.3f, \"args\": {",
+                    sep, ring->tid, sample->time);
+            for (int c = 0; c < TRACE_COUNTER_COUNT; c++) {
+                fprintf(f, "%s\"%s\": %ld", c ? ", " : "", counter_names[c], sample->values[c]);
+            }
+            fprintf(f, "}}");
+        }
+    }
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Timed spans and counters for the hot paths. Each thread records into its
+// own ring buffer, so tracing never takes a lock and keeps the most recent
+// events once a ring fills. Natively the rings export as Chrome trace JSON
+// (chrome://tracing or ui.perfetto.dev); in the browser every span is also
+// sent to performance.measure and every counter sample to performance.mark,
+// so both show up in the DevTools performance panel. Nothing is recorded
+// until trace_set_enabled(1), and -DTRACE_ENABLED=0 compiles it all out.
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+typedef enum {
+    TRACE_CANDIDATES,  // particles distance-tested by grid queries
+    TRACE_CELLS,       // grid cells a query looked into
+    TRACE_CACHE_HITS,  // neighbor lists reused without a query
+    TRACE_COUNTER_COUNT
+} TraceCounter;
+
+#if TRACE_ENABLED
+
+void trace_set_enabled(int enabled);
+int trace_is_enabled(void);
+
+// Opens and closes a span on the calling thread. Spans nest up to 16 deep;
+// name is kept by pointer, so pass a string literal.
+void trace_begin(const char *name);
+void trace_end(void);
+
+// Adds n to a counter on the calling thread.
+void trace_count(TraceCounter counter, long n);
+// Sums every thread's counters into one sample and zeroes them. Call once a
+// frame from the thread that drives the workers, while they are idle.
+void trace_flush_counters(void);
+
+// Labels the calling thread in the export.
+void trace_set_thread_name(const char *name);
+
+// Writes every ring as Chrome trace JSON. No other thread may be recording
+// while it runs. Returns 0 on success, -1 if the file can't be written.
+int trace_write_chrome_json(const char *path);
+
+#else
+
+static inline void trace_set_enabled(int enabled) { (void)enabled; }
+static inline int trace_is_enabled(void) { return 0; }
+static inline void trace_begin(const char *name) { (void)name; }
+static inline void trace_end(void) {}
+static inline void trace_count(TraceCounter counter, long n) { (void)counter; (void)n; }
+static inline void trace_flush_counters(void) {}
+static inline void trace_set_thread_name(const char *name) { (void)name; }
+static inline int trace_write_chrome_json(const char *path) { (void)path; return -1; }
+
+#endif
+
+#endif
@@ -0,0 +1,458 @@
+#define _POSIX_C_SOURCE 200809L
+#include "trajectory.h"
+#include "snapshot.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define TRAJECTORY_INLINE 1
+#else
+#define TRAJECTORY_INLINE 0
+#include <pthread.h>
+#endif
+
+#define QUEUE_FRAMES 8       // frames the writer may fall behind before pushes drop
+#define MAX_VARINT_BYTES 3   // a zigzagged 16-bit residual
+
+typedef struct {
+    uint16_t* q[3];  // by handle
+    int count;
+    int capacity;
+    uint64_t frame;
+} QueuedFrame;
+
+// The two frames before the current one, by handle. Coding frame k reads
+// last and before for each value and then overwrites before with it, so
+// swapping the two afterwards shifts the history without a copy.
+typedef struct {
+    uint16_t* last[3];
+    uint16_t* before[3];
+    int capacity;
+} History;
+
+struct TrajectoryRecorder {
+    FILE* file;
+    float inv_bounds[3];
+    int chunk_frames;
+
+    QueuedFrame queue[QUEUE_FRAMES];
+    int head;    // next slot push fills
+    int queued;  // filled slots, oldest at head - queued
+
+    // Writer side: the open chunk and its history.
+    TrajectoryChunk chunk;
+    uint8_t* payload;
+    size_t payload_size;
+    size_t payload_capacity;
+    History history;
+    int failed;
+
+    TrajectoryStats stats;
+
+#if !TRAJECTORY_INLINE
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    int closing;
+#endif
+};
+
+struct TrajectoryPlayer {
+    FILE* file;
+    TrajectoryHeader header;
+    TrajectoryChunk chunk;
+    uint8_t* payload;
+    size_t payload_capacity;
+    const uint8_t* cursor;
+    const uint8_t* end;
+    uint32_t decoded;  // frames of chunk already returned
+    History history;
+};
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int grow_array(void** array, size_t elem_size, int capacity) {
+    void* grown = realloc(*array, elem_size * capacity);
+    if (!grown) return -1;
+    *array = grown;
+    return 0;
+}
+
+static int reserve_history(History* h, int capacity) {
+    if (capacity <= h->capacity) return 0;
+    for (int a = 0; a < 3; a++) {
+        if (grow_array((void**)&h->last[a], sizeof(uint16_t), capacity) != 0 ||
+            grow_array((void**)&h->before[a], sizeof(uint16_t), capacity) != 0) {
+            return -1;
+        }
+    }
+    h->capacity = capacity;
+    return 0;
+}
+
+static void swap_history(History* h, int axis) {
+    uint16_t* tmp = h->last[axis];
+    h->last[axis] = h->before[axis];
+    h->before[axis] = tmp;
+}
+
+static void free_history(History* h) {
+    for (int a = 0; a < 3; a++) {
+        free(h->last[a]);
+        free(h->before[a]);
+    }
+}
+
+// Constant velocity: the next value continues the last step. Arithmetic is
+// mod 2^16, so a particle wrapping across a periodic bound costs no more
+// than any other move.
+static inline uint16_t predict(const History* h, int axis, int i, uint32_t k) {
+    if (k == 1) return h->last[axis][i];
+    return (uint16_t)(2u * h->last[axis][i] - h->before[axis][i]);
+}
+
+static inline uint8_t* put_varint(uint8_t* out, uint16_t residual) {
+    int16_t r = (int16_t)residual;
+    uint32_t v = (uint16_t)((uint16_t)r << 1) ^ (uint16_t)(r >> 15);
+    while (v >= 0x80) {
+        *out++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *out++ = (uint8_t)v;
+    return out;
+}
+
+static inline int get_varint(const uint8_t** cursor, const uint8_t* end, uint16_t* residual) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 7 * MAX_VARINT_BYTES; shift += 7) {
+        if (*cursor == end) return -1;
+        uint8_t b = *(*cursor)++;
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *residual = (uint16_t)((v >> 1) ^ (0u - (v & 1)));
+            return 0;
+        }
+    }
+    return -1;
+}
+
+#if TRAJECTORY_INLINE
+static void lock(TrajectoryRecorder* rec) { (void)rec; }
+static void unlock(TrajectoryRecorder* rec) { (void)rec; }
+#else
+static void lock(TrajectoryRecorder* rec) { pthread_mutex_lock(&rec->mutex); }
+static void unlock(TrajectoryRecorder* rec) { pthread_mutex_unlock(&rec->mutex); }
+#endif
+
+// Writer side from here to trajectory_recorder_create.
+
+static void flush_chunk(TrajectoryRecorder* rec) {
+    TrajectoryChunk* chunk = &rec->chunk;
+    if (chunk->frames == 0) return;
+    chunk->magic = TRAJECTORY_CHUNK_MAGIC;
+    chunk->bytes = (uint32_t)rec->payload_size;
+    if (fwrite(chunk, sizeof(*chunk), 1, rec->file) != 1 ||
+        fwrite(rec->payload, 1, rec->payload_size, rec->file) != rec->payload_size) {
+        rec->failed = 1;
+    }
+
+    lock(rec);
+    rec->stats.frames += chunk->frames;
+    rec->stats.bytes += (long)(sizeof(*chunk) + rec->payload_size);
+    unlock(rec);
+    chunk->frames = 0;
+    rec->payload_size = 0;
+}
+
+static void encode_frame(TrajectoryRecorder* rec, const QueuedFrame* f) {
+    TrajectoryChunk* chunk = &rec->chunk;
+    if (chunk->frames > 0 &&
+        ((uint32_t)f->count != chunk->count || f->frame != chunk->first_frame + chunk->frames ||
+         chunk->frames >= (uint32_t)rec->chunk_frames)) {
+        flush_chunk(rec);
+    }
+    if (chunk->frames == 0) {
+        chunk->count = (uint32_t)f->count;
+        chunk->first_frame = f->frame;
+    }
+
+    size_t need = rec->payload_size + (size_t)f->count * 3 * MAX_VARINT_BYTES;
+    if (need > rec->payload_capacity) {
+        size_t capacity = rec->payload_capacity ? rec->payload_capacity : 4096;
+        while (capacity < need) capacity *= 2;
+        uint8_t* grown = realloc(rec->payload, capacity);
+        if (!grown) {
+            // Drop the frame; the next one opens a chunk of its own.
+            rec->failed = 1;
+            flush_chunk(rec);
+            return;
+        }
+        rec->payload = grown;
+        rec->payload_capacity = capacity;
+    }
+    if (reserve_history(&rec->history, f->count) != 0) {
+        rec->failed = 1;
+        flush_chunk(rec);
+        return;
+    }
+
+    uint8_t* out = rec->payload + rec->payload_size;
+    uint32_t k = chunk->frames;
+    History* h = &rec->history;
+    for (int a = 0; a < 3; a++) {
+        const uint16_t* q = f->q[a];
+        uint16_t* before = h->before[a];
+        if (k == 0) {
+            memcpy(out, q, sizeof(uint16_t) * f->count);
+            out += sizeof(uint16_t) * f->count;
+            memcpy(before, q, sizeof(uint16_t) * f->count);
+        } else {
+            for (int i = 0; i < f->count; i++) {
+                out = put_varint(out, (uint16_t)(q[i] - predict(h, a, i, k)));
+                before[i] = q[i];
+            }
+        }
+        swap_history(h, a);
+    }
+    rec->payload_size = (size_t)(out - rec->payload);
+    chunk->frames++;
+}
+
+#if !TRAJECTORY_INLINE
+static void* writer_main(void* arg) {
+    TrajectoryRecorder* rec = (TrajectoryRecorder*)arg;
+    trace_set_thread_name("recorder");
+    pthread_mutex_lock(&rec->mutex);
+    for (;;) {
+        while (rec->queued == 0 && !rec->closing) {
+            pthread_cond_wait(&rec->wake, &rec->mutex);
+        }
+        if (rec->queued == 0) break;
+        int tail = (rec->head - rec->queued + QUEUE_FRAMES) % QUEUE_FRAMES;
+        const QueuedFrame* f = &rec->queue[tail];
+        pthread_mutex_unlock(&rec->mutex);
+
+        // The slot stays queued, so push leaves it alone while it is coded.
+        trace_begin("encode");
+        encode_frame(rec, f);
+        trace_end();
+
+        pthread_mutex_lock(&rec->mutex);
+        rec->queued--;
+    }
+    pthread_mutex_unlock(&rec->mutex);
+    return NULL;
+}
+#endif
+
+TrajectoryRecorder* trajectory_recorder_create(const char* path, float width, float height,
+                                               float depth, int chunk_frames) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return NULL;
+    TrajectoryHeader header = {TRAJECTORY_MAGIC, TRAJECTORY_VERSION, width, height, depth, 0};
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        return NULL;
+    }
+
+    TrajectoryRecorder* rec = calloc(1, sizeof(TrajectoryRecorder));
+    rec->file = file;
+    rec->inv_bounds[0] = 1.0f / width;
+    rec->inv_bounds[1] = 1.0f / height;
+    rec->inv_bounds[2] = 1.0f / depth;
+    rec->chunk_frames = chunk_frames > 0 ? chunk_frames : TRAJECTORY_CHUNK_FRAMES;
+    rec->stats.bytes = sizeof(header);
+#if !TRAJECTORY_INLINE
+    pthread_mutex_init(&rec->mutex, NULL);
+    pthread_cond_init(&rec->wake, NULL);
+    pthread_create(&rec->thread, NULL, writer_main, rec);
+#endif
+    return rec;
+}
+
+int trajectory_recorder_destroy(TrajectoryRecorder* rec, TrajectoryStats* stats) {
+    if (!rec) return 0;
+#if !TRAJECTORY_INLINE
+    pthread_mutex_lock(&rec->mutex);
+    rec->closing = 1;
+    pthread_cond_signal(&rec->wake);
+    pthread_mutex_unlock(&rec->mutex);
+    pthread_join(rec->thread, NULL);
+#endif
+    flush_chunk(rec);
+    if (fclose(rec->file) != 0) rec->failed = 1;
+    int status = rec->failed ? -1 : 0;
+    if (stats) *stats = rec->stats;
+
+#if !TRAJECTORY_INLINE
+    pthread_cond_destroy(&rec->wake);
+    pthread_mutex_destroy(&rec->mutex);
+#endif
+    for (int s = 0; s < QUEUE_FRAMES; s++) {
+        for (int a = 0; a < 3; a++) {
+            free(rec->queue[s].q[a]);
+        }
+    }
+    free_history(&rec->history);
+    free(rec->payload);
+    free(rec);
+    return status;
+}
+
+int trajectory_recorder_push(TrajectoryRecorder* rec, const ParticleSoA* particles,
+                             uint64_t frame) {
+    double start = now_ms();
+    lock(rec);
+    int full = rec->queued == QUEUE_FRAMES;
+    if (full) rec->stats.dropped++;
+    QueuedFrame* f = &rec->queue[rec->head];
+    unlock(rec);
+    if (full) return -1;
+
+    // Only this thread writes the head slot, and the writer won't read it
+    // until it is queued, so it is filled without the lock.
+    int count = particles->count;
+    if (count > f->capacity) {
+        for (int a = 0; a < 3; a++) {
+            if (grow_array((void**)&f->q[a], sizeof(uint16_t), count) != 0) {
+                lock(rec);
+                rec->stats.dropped++;
+                unlock(rec);
+                return -1;
+            }
+        }
+        f->capacity = count;
+    }
+    const float* axes[3] = {particles->x, particles->y, particles->z};
+    for (int a = 0; a < 3; a++) {
+        const float* v = axes[a];
+        uint16_t* q = f->q[a];
+        float inv_bound = rec->inv_bounds[a];
+        for (int i = 0; i < count; i++) {
+            q[particles->handle_of_slot[i]] = snapshot_pack_position(v[i], inv_bound);
+        }
+    }
+    f->count = count;
+    f->frame = frame;
+
+#if TRAJECTORY_INLINE
+    encode_frame(rec, f);
+#else
+    pthread_mutex_lock(&rec->mutex);
+    rec->head = (rec->head + 1) % QUEUE_FRAMES;
+    rec->queued++;
+    pthread_cond_signal(&rec->wake);
+    pthread_mutex_unlock(&rec->mutex);
+#endif
+    double elapsed = now_ms() - start;
+    lock(rec);
+    rec->stats.push_ms += elapsed;
+    unlock(rec);
+    return 0;
+}
+
+TrajectoryStats trajectory_recorder_stats(TrajectoryRecorder* rec) {
+    lock(rec);
+    TrajectoryStats stats = rec->stats;
+    unlock(rec);
+    return stats;
+}
+
+static int read_chunk(TrajectoryPlayer* player) {
+    TrajectoryChunk* chunk = &player->chunk;
+    if (fread(chunk, sizeof(*chunk), 1, player->file) != 1 ||
+        chunk->magic != TRAJECTORY_CHUNK_MAGIC || chunk->frames == 0 ||
+        chunk->count > INT32_MAX / 2) {
+        chunk->frames = 0;
+        return -1;
+    }
+    if (chunk->bytes > player->payload_capacity) {
+        uint8_t* grown = realloc(player->payload, chunk->bytes);
+        if (!grown) return -1;
+        player->payload = grown;
+        player->payload_capacity = chunk->bytes;
+    }
+    if (fread(player->payload, 1, chunk->bytes, player->file) != chunk->bytes ||
+        reserve_history(&player->history, (int)chunk->count) != 0) {
+        chunk->frames = 0;
+        return -1;
+    }
+    player->cursor = player->payload;
+    player->end = player->payload + chunk->bytes;
+    player->decoded = 0;
+    return 0;
+}
+
+TrajectoryPlayer* trajectory_player_open(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    TrajectoryPlayer* player = calloc(1, sizeof(TrajectoryPlayer));
+    player->file = file;
+    TrajectoryHeader* header = &player->header;
+    if (fread(header, sizeof(*header), 1, file) != 1 || header->magic != TRAJECTORY_MAGIC ||
+        header->version != TRAJECTORY_VERSION) {
+        trajectory_player_close(player);
+        return NULL;
+    }
+    return player;
+}
+
+void trajectory_player_close(TrajectoryPlayer* player) {
+    if (!player) return;
+    fclose(player->file);
+    free_history(&player->history);
+    free(player->payload);
+    free(player);
+}
+
+void trajectory_player_bounds(const TrajectoryPlayer* player, float* width, float* height,
+                              float* depth) {
+    *width = player->header.width;
+    *height = player->header.height;
+    *depth = player->header.depth;
+}
+
+long trajectory_player_next(TrajectoryPlayer* player, ParticleSoA* out) {
+    if (player->decoded == player->chunk.frames && read_chunk(player) != 0) return -1;
+
+    int count = (int)player->chunk.count;
+    if (particle_soa_reserve(out, count) != 0) return -1;
+    uint32_t k = player->decoded;
+    History* h = &player->history;
+    const float bounds[3] = {player->header.width, player->header.height, player->header.depth};
+    float* axes[3] = {out->x, out->y, out->z};
+    for (int a = 0; a < 3; a++) {
+        uint16_t* before = h->before[a];
+        if (k == 0) {
+            if ((size_t)(player->end - player->cursor) < sizeof(uint16_t) * count) return -1;
+            memcpy(before, player->cursor, sizeof(uint16_t) * count);
+            player->cursor += sizeof(uint16_t) * count;
+        } else {
+            for (int i = 0; i < count; i++) {
+                uint16_t residual;
+                if (get_varint(&player->cursor, player->end, &residual) != 0) return -1;
+                before[i] = (uint16_t)(predict(h, a, i, k) + residual);
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            axes[a][i] = snapshot_unpack_position(before[i], bounds[a]);
+        }
+        swap_history(h, a);
+    }
+    out->count = count;
+    player->decoded++;
+    return (long)(player->chunk.first_frame + k);
+}
+
+void trajectory_player_rewind(TrajectoryPlayer* player) {
+    fseek(player->file, sizeof(TrajectoryHeader), SEEK_SET);
+    player->chunk.frames = 0;
+    player->decoded = 0;
+}
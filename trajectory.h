@@ -0,0 +1,79 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <stdint.h>
+#include "particle_soa.h"
+
+// Streaming flock recordings. Positions are quantized by handle onto the
+// snapshot lattice (16 bits per axis across the bounds) and stored as
+// runs of chunks. A chunk opens with one raw keyframe; later frames hold
+// the per-axis error of a constant-velocity guess (2 * last - the one
+// before), zigzag varint coded, which is one byte per value for all but
+// the fastest turns and wraps. Every chunk decodes on its own, so a
+// dropped frame or a count change only starts a new one.
+//
+// File: TrajectoryHeader, then per chunk a TrajectoryChunk and its bytes
+// of payload. The keyframe is x, y, z as uint16 arrays; each later frame
+// is count x residuals, then y, then z. Little-endian throughout.
+#define TRAJECTORY_MAGIC 0x544b4c46u  // "FLKT"
+#define TRAJECTORY_CHUNK_MAGIC 0x434b4c46u  // "FLKC"
+#define TRAJECTORY_VERSION 1
+#define TRAJECTORY_CHUNK_FRAMES 120  // default chunk length, 2 s at 60 Hz
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    float width, height, depth;
+    uint32_t reserved;
+} TrajectoryHeader;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t count;   // particles per frame
+    uint32_t frames;
+    uint32_t bytes;   // payload after this header
+    uint64_t first_frame;
+} TrajectoryChunk;
+
+typedef struct {
+    long frames;     // frames written
+    long dropped;    // frames pushed while the queue was full
+    long bytes;      // file size so far
+    double push_ms;  // caller time spent in trajectory_recorder_push
+} TrajectoryStats;
+
+typedef struct TrajectoryRecorder TrajectoryRecorder;
+
+// Records into path, which is truncated. Frames are encoded and written on
+// a background thread (inline in builds without pthreads); a chunk closes
+// after chunk_frames frames. Returns NULL if the file can't be created.
+TrajectoryRecorder *trajectory_recorder_create(const char *path, float width, float height,
+                                               float depth, int chunk_frames);
+// Drains the queue, writes the open chunk and closes the file, leaving the
+// final counters in stats if it is set. Returns 0, or -1 if any write
+// failed.
+int trajectory_recorder_destroy(TrajectoryRecorder *rec, TrajectoryStats *stats);
+// Quantizes the current positions into the queue and returns without
+// touching the disk. frame numbers the step; a gap starts a new chunk. If
+// the writer has fallen a full queue behind the frame is dropped and -1
+// returned.
+int trajectory_recorder_push(TrajectoryRecorder *rec, const ParticleSoA *particles,
+                             uint64_t frame);
+// Snapshot of the counters; the writer updates frames and bytes as it goes.
+TrajectoryStats trajectory_recorder_stats(TrajectoryRecorder *rec);
+
+typedef struct TrajectoryPlayer TrajectoryPlayer;
+
+// Reads a recording one chunk at a time. NULL if path isn't one.
+TrajectoryPlayer *trajectory_player_open(const char *path);
+void trajectory_player_close(TrajectoryPlayer *player);
+void trajectory_player_bounds(const TrajectoryPlayer *player, float *width, float *height,
+                              float *depth);
+// Decodes the next frame into x, y, z and count of out (slot = handle),
+// growing it as needed. Returns the frame number, or -1 at the end of the
+// file or on a damaged chunk.
+long trajectory_player_next(TrajectoryPlayer *player, ParticleSoA *out);
+// Back to the first frame.
+void trajectory_player_rewind(TrajectoryPlayer *player);
+
+#endif
@@ -1,39 +1,170 @@
 #ifndef VECTOR3D_H
 #define VECTOR3D_H
 
+#include <float.h>
 #include <math.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// 1 = vec3_steer and vec3_clamp take the sqrtf-and-divide path of
+// vec3_set_mag / vec3_limit, for validating the rsqrt one against.
+#ifndef VEC3_EXACT_STEER
+#define VEC3_EXACT_STEER 0
+#endif
+
 typedef struct {
   float x;
   float y;
   float z;
 } Vector3D;
 
-Vector3D vec3_create(float x, float y, float z);
-void vec3_add(Vector3D *v1, const Vector3D *v2);
-void vec3_sub(Vector3D *v1, const Vector3D *v2);
-void vec3_mult(Vector3D *v, float n);
-void vec3_div(Vector3D *v, float n);
-float vec3_mag(const Vector3D *v);
-float vec3_mag_sq(const Vector3D *v);
-void vec3_normalize(Vector3D *v);
-void vec3_limit(Vector3D *v, float max);
-void vec3_set_mag(Vector3D *v, float mag);
-float vec3_dist(const Vector3D *v1, const Vector3D *v2);
-float vec3_dist_sq(const Vector3D *v1, const Vector3D *v2);
-Vector3D vec3_copy(const Vector3D *v);
-Vector3D vec3_sub_new(const Vector3D *v1, const Vector3D *v2);
-Vector3D vec3_random3d(void);
+// Everything but vec3_random3d is inline, so chains of ops keep their
+// components in registers instead of round-tripping through memory.
+
+static inline Vector3D vec3_create(float x, float y, float z) {
+    Vector3D v = {x, y, z};
+    return v;
+}
+
+// By-value ops: these return a new vector and leave their arguments alone.
+
+static inline Vector3D vec3_plus(Vector3D a, Vector3D b) {
+    return vec3_create(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+static inline Vector3D vec3_minus(Vector3D a, Vector3D b) {
+    return vec3_create(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+static inline Vector3D vec3_scaled(Vector3D v, float n) {
+    return vec3_create(v.x * n, v.y * n, v.z * n);
+}
+
+static inline float vec3_dot(Vector3D a, Vector3D b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline float vec3_length_sq(Vector3D v) {
+    return vec3_dot(v, v);
+}
+
+static inline float vec3_length(Vector3D v) {
+    return sqrtf(vec3_dot(v, v));
+}
+
+// Unit vector along v; a zero vector stays zero.
+static inline Vector3D vec3_normalized(Vector3D v) {
+    float m = vec3_length(v);
+    return m > 0.0f ? vec3_create(v.x / m, v.y / m, v.z / m) : v;
+}
+
+// In-place ops on pointers, kept for existing callers.
+
+static inline void vec3_add(Vector3D *v1, const Vector3D *v2) {
+    *v1 = vec3_plus(*v1, *v2);
+}
+
+static inline void vec3_sub(Vector3D *v1, const Vector3D *v2) {
+    *v1 = vec3_minus(*v1, *v2);
+}
+
+static inline void vec3_mult(Vector3D *v, float n) {
+    *v = vec3_scaled(*v, n);
+}
+
+static inline void vec3_div(Vector3D *v, float n) {
+    if (n != 0.0f) {
+        *v = vec3_create(v->x / n, v->y / n, v->z / n);
+    }
+}
+
+static inline float vec3_mag(const Vector3D *v) {
+    return vec3_length(*v);
+}
+
+static inline float vec3_mag_sq(const Vector3D *v) {
+    return vec3_length_sq(*v);
+}
+
+static inline void vec3_normalize(Vector3D *v) {
+    *v = vec3_normalized(*v);
+}
+
+static inline void vec3_limit(Vector3D *v, float max) {
+    if (vec3_mag(v) > max) {
+        *v = vec3_scaled(vec3_normalized(*v), max);
+    }
+}
+
+static inline void vec3_set_mag(Vector3D *v, float mag) {
+    *v = vec3_scaled(vec3_normalized(*v), mag);
+}
+
+static inline float vec3_dist(const Vector3D *v1, const Vector3D *v2) {
+    return vec3_length(vec3_minus(*v1, *v2));
+}
+
+static inline float vec3_dist_sq(const Vector3D *v1, const Vector3D *v2) {
+    return vec3_length_sq(vec3_minus(*v1, *v2));
+}
+
+static inline Vector3D vec3_copy(const Vector3D *v) {
+    return *v;
+}
+
+static inline Vector3D vec3_sub_new(const Vector3D *v1, const Vector3D *v2) {
+    return vec3_minus(*v1, *v2);
+}
 
 static inline float vec3_mag_sq_inline(const Vector3D *v) {
-    return v->x * v->x + v->y * v->y + v->z * v->z;
+    return vec3_length_sq(*v);
 }
 
 static inline float vec3_dist_sq_inline(const Vector3D *v1, const Vector3D *v2) {
-    float dx = v1->x - v2->x;
-    float dy = v1->y - v2->y;
-    float dz = v1->z - v2->z;
-    return dx * dx + dy * dy + dz * dz;
+    return vec3_length_sq(vec3_minus(*v1, *v2));
+}
+
+// Uniform direction on the unit sphere from the calling thread's RNG.
+Vector3D vec3_random3d(void);
+
+// 1/sqrt(x) for x > 0: the SSE estimate (12 bits) refined by one Newton
+// step to about 23 bits. Targets without an estimate divide instead.
+static inline float vec3_rsqrt(float x) {
+#if defined(__SSE__)
+    float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+    return y * (1.5f - 0.5f * x * y * y);
+#else
+    return 1.0f / sqrtf(x);
+#endif
+}
+
+// By-value vec3_limit.
+static inline Vector3D vec3_clamp(Vector3D v, float max) {
+    float m_sq = vec3_length_sq(v);
+    if (m_sq > max * max) {
+#if VEC3_EXACT_STEER
+        v = vec3_scaled(vec3_normalized(v), max);
+#else
+        v = vec3_scaled(v, max * vec3_rsqrt(m_sq));
+#endif
+    }
+    return v;
+}
+
+// The tail of every steering rule: desired rescaled to max_speed, minus
+// velocity, clamped to max_force. Two rsqrts and no divides where
+// set_mag + sub + limit took three sqrtf and nine divides.
+static inline Vector3D vec3_steer(Vector3D desired, float max_speed,
+                                  const Vector3D *velocity, float max_force) {
+#if VEC3_EXACT_STEER
+    desired = vec3_scaled(vec3_normalized(desired), max_speed);
+#else
+    float d_sq = vec3_length_sq(desired);
+    desired = vec3_scaled(desired, d_sq > FLT_MIN ? max_speed * vec3_rsqrt(d_sq) : 0.0f);
+#endif
+    return vec3_clamp(vec3_minus(desired, *velocity), max_force);
 }
 
 #endif